@@ -0,0 +1,582 @@
+//Scale and churn benchmark: hundreds of emulated devices connect, bind, run echo tasks and disconnect
+//continuously while Network is queried. Reports per-node memory and threads, hotplug-to-ready latency,
+//query latency and task throughput under churn.
+//Usage: MicroNetworkHostStress [devices=200] [seconds=30] [churnPerSecond=50] [workers=8]
+
+#include <MicroNetwork/Host/Network.h>
+#include <MicroNetwork/Host/LinkProvider.h>
+#include <LFramework/Threading/Semaphore.h>
+#include <LFramework/Threading/CriticalSection.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+using MicroNetwork::Host::ILinkCallback;
+using MicroNetwork::Host::LinkProvider;
+using MicroNetwork::Host::Network;
+using MicroNetwork::Host::NodeHandle;
+using MicroNetwork::Host::NodeState;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr std::uint32_t EchoPacketId = 1;
+constexpr std::uint32_t EchoPacketsPerTask = 16;
+constexpr auto EchoTimeout = std::chrono::seconds(1);
+constexpr auto DeviceDownTime = std::chrono::milliseconds(100);
+constexpr std::uint32_t GuidPrefix[3] = { 0x6d6e6873, 0x74726573, 0x73000000 };
+
+LFramework::Guid makeGuid(std::uint32_t value) {
+    std::uint32_t words[4] = { GuidPrefix[0], GuidPrefix[1], GuidPrefix[2], value };
+    LFramework::Guid result;
+    static_assert(sizeof(result) == sizeof(words), "Unexpected Guid layout");
+    memcpy(&result, words, sizeof(result));
+    return result;
+}
+
+const LFramework::Guid EchoTaskId = makeGuid(0xffffffff);
+
+//Every device also reports a task unique to it, so a ready node can be matched with its plug time
+std::optional<std::uint32_t> parseIdentityTaskId(const LFramework::Guid& taskId) {
+    std::uint32_t words[4];
+    memcpy(words, &taskId, sizeof(words));
+    if((memcmp(words, GuidPrefix, sizeof(GuidPrefix)) != 0) || (taskId == EchoTaskId)){
+        return std::nullopt;
+    }
+    return words[3];
+}
+
+class Histogram {
+public:
+    void add(Clock::duration duration) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _samples.push_back(std::chrono::duration<double, std::micro>(duration).count());
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _samples.clear();
+    }
+
+    void print(const char* name) {
+        std::vector<double> samples;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            samples = _samples;
+        }
+        if(samples.empty()){
+            printf("  %-28s no samples\n", name);
+            return;
+        }
+        std::sort(samples.begin(), samples.end());
+        auto percentile = [&](double p){ return samples[static_cast<std::size_t>(p * (samples.size() - 1))]; };
+        printf("  %-28s n=%-8zu p50=%10.1fus p99=%10.1fus max=%10.1fus\n", name, samples.size(), percentile(0.5), percentile(0.99), samples.back());
+    }
+private:
+    std::mutex _mutex;
+    std::vector<double> _samples;
+};
+
+struct ProcessStats {
+    std::size_t rssKb = 0;
+    std::size_t threads = 0;
+};
+
+ProcessStats readProcessStats() {
+    ProcessStats result;
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while(std::getline(status, line)){
+        if(line.compare(0, 6, "VmRSS:") == 0){
+            result.rssKb = std::stoul(line.substr(6));
+        }else if(line.compare(0, 8, "Threads:") == 0){
+            result.threads = std::stoul(line.substr(8));
+        }
+    }
+    return result;
+}
+
+//Device side of the protocol: answers Bind with task descriptions, acknowledges TaskStart and TaskStop,
+//echoes task packets. One thread per device, like a USB link has per-link threads
+class EmulatedDevice : public MicroNetwork::Common::DataStream {
+public:
+    EmulatedDevice(std::uint32_t index) : _index(index) {
+
+    }
+
+    ~EmulatedDevice() {
+        disconnect();
+        if(_thread.joinable()){
+            _thread.join();
+        }
+    }
+
+    bool start() override {
+        reset();
+        _running = true;
+        _thread = std::thread(&EmulatedDevice::threadHandler, this);
+        return true;
+    }
+
+    //Emulates cable pull
+    void disconnect() {
+        if(_running.exchange(false)){
+            notifyDisconnect();
+        }
+        _job.give();
+        _space.give();
+    }
+private:
+    void onRemoteDisconnect() override {
+        _running = false;
+        _job.give();
+        _space.give();
+    }
+    void onRemoteReset() override {
+
+    }
+    void onRemoteDataAvailable() override {
+        _job.give();
+    }
+    void onReadBytes() override {
+        _space.give();
+    }
+
+    void threadHandler() {
+        MicroNetwork::Common::MaxPacket packet;
+        while(_running){
+            _job.take();
+            while(_running && readPacket(packet)){
+                handlePacket(packet);
+            }
+        }
+    }
+
+    bool readPacket(MicroNetwork::Common::MaxPacket& packet) {
+        LFramework::Threading::CriticalSection lock;
+        if(_remote == nullptr){
+            return false;
+        }
+        if(!_remote->peek(&packet.header, sizeof(packet.header))){
+            return false;
+        }
+        auto packetFullSize = sizeof(packet.header) + packet.header.size;
+        if(_remote->bytesAvailable() < packetFullSize){
+            return false;
+        }
+        return _remote->read(&packet, packetFullSize) == packetFullSize;
+    }
+
+    bool writePacket(MicroNetwork::Common::PacketHeader header, const void* data) {
+        while(_running){
+            {
+                LFramework::Threading::CriticalSection lock;
+                if(freeSpace() >= packetFullSize(header)){
+                    write(&header, sizeof(header));
+                    if(header.size != 0){
+                        write(data, header.size);
+                    }
+                    return true;
+                }
+            }
+            _space.take();
+        }
+        return false;
+    }
+
+    void handlePacket(const MicroNetwork::Common::MaxPacket& packet) {
+        using MicroNetwork::Common::PacketId;
+        MicroNetwork::Common::MaxPacket response;
+        if(packet.header.id == PacketId::Bind){
+            response.header.id = PacketId::Bind;
+            response.setData(static_cast<std::uint32_t>(2));
+            writePacket(response.header, response.payload.data());
+            response.header.id = PacketId::TaskDescription;
+            response.setData(EchoTaskId);
+            writePacket(response.header, response.payload.data());
+            response.header.id = PacketId::TaskDescription;
+            response.setData(makeGuid(_index));
+            writePacket(response.header, response.payload.data());
+        }else if(packet.header.id == PacketId::TaskStart){
+            _taskRunning = true;
+            writePacket(packet.header, packet.payload.data());
+        }else if(packet.header.id == PacketId::TaskStop){
+            _taskRunning = false;
+            response.header.id = PacketId::TaskStop;
+            response.header.size = 0;
+            writePacket(response.header, nullptr);
+        }else if(_taskRunning){
+            writePacket(packet.header, packet.payload.data());
+        }
+    }
+
+    std::uint32_t _index;
+    std::atomic<bool> _running = false;
+    bool _taskRunning = false;
+    std::thread _thread;
+    LFramework::Threading::BinarySemaphore _job;
+    LFramework::Threading::BinarySemaphore _space;
+};
+
+class EmulatedLinkProvider : public LinkProvider {
+public:
+    EmulatedLinkProvider(ILinkCallback* linkCallback) : LinkProvider(linkCallback) {
+
+    }
+
+    void plug(std::uint32_t device) {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _plugTimes[device] = Clock::now();
+        }
+        onLinksUpdated();
+    }
+
+    void unplug(std::uint32_t device) {
+        std::shared_ptr<EmulatedDevice> stream;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _plugTimes.erase(device);
+            auto it = _streams.find(device);
+            if(it != _streams.end()){
+                stream = it->second.lock();
+                _streams.erase(it);
+            }
+        }
+        if(stream != nullptr){
+            stream->disconnect();
+        }
+        onLinksUpdated();
+    }
+
+    std::optional<Clock::time_point> getPlugTime(std::uint32_t device) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto it = _plugTimes.find(device);
+        if(it == _plugTimes.end()){
+            return std::nullopt;
+        }
+        return it->second;
+    }
+private:
+    static constexpr const char* PathPrefix = "emulated:";
+
+    std::vector<std::string> getLinks() override {
+        std::lock_guard<std::mutex> lock(_mutex);
+        std::vector<std::string> result;
+        for(auto& device : _plugTimes){
+            result.push_back(PathPrefix + std::to_string(device.first));
+        }
+        return result;
+    }
+
+    std::shared_ptr<MicroNetwork::Common::DataStream> makeStream(const std::string& linkPath) override {
+        auto device = static_cast<std::uint32_t>(std::stoul(linkPath.substr(strlen(PathPrefix))));
+        auto stream = std::make_shared<EmulatedDevice>(device);
+        std::lock_guard<std::mutex> lock(_mutex);
+        _streams[device] = stream;
+        return stream;
+    }
+
+    std::mutex _mutex;
+    std::unordered_map<std::uint32_t, Clock::time_point> _plugTimes;
+    std::unordered_map<std::uint32_t, std::weak_ptr<EmulatedDevice>> _streams;
+};
+
+struct EchoState {
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::uint32_t received = 0;
+    bool closed = false;
+
+    bool wait(std::uint32_t count) {
+        std::unique_lock<std::mutex> lock(mutex);
+        return changed.wait_for(lock, EchoTimeout, [&]{ return closed || (received >= count); }) && !closed;
+    }
+};
+
+class EchoReceiver : public LFramework::RefCountedObject {
+public:
+    EchoReceiver(std::shared_ptr<EchoState> state) : _state(state) {
+
+    }
+    LFramework::Result packet(MicroNetwork::Common::PacketHeader header, const void* data) {
+        (void)data;
+        if(header.id == EchoPacketId){
+            std::lock_guard<std::mutex> lock(_state->mutex);
+            ++_state->received;
+            _state->changed.notify_all();
+        }
+        return LFramework::Result::Ok;
+    }
+    void onRelease() {
+        std::lock_guard<std::mutex> lock(_state->mutex);
+        _state->closed = true;
+        _state->changed.notify_all();
+    }
+private:
+    std::shared_ptr<EchoState> _state;
+};
+
+struct Benchmark {
+    std::uint32_t devices = 200;
+    std::uint32_t seconds = 30;
+    std::uint32_t churnPerSecond = 50;
+    std::uint32_t workers = 8;
+
+    std::shared_ptr<EmulatedLinkProvider> provider;
+    std::unique_ptr<Network> network;
+    std::atomic<bool> running = true;
+    std::atomic<std::size_t> readyNodes = 0;
+    std::atomic<std::size_t> maxThreads = 0;
+    std::atomic<std::size_t> maxRssKb = 0;
+    std::atomic<std::uint64_t> tasksCompleted = 0;
+    std::atomic<std::uint64_t> startFailures = 0;
+    std::atomic<std::uint64_t> echoTimeouts = 0;
+    std::atomic<std::uint64_t> plugEvents = 0;
+
+    Histogram plugLatency;
+    Histogram unplugLatency;
+    Histogram hotplugToReady;
+    Histogram getNodesLatency;
+    Histogram getNodeStateLatency;
+    Histogram idleCountLatency;
+    Histogram startTaskLatency;
+    Histogram echoLatency;
+
+    //Polls Network like an application would, detects nodes becoming ready
+    void monitorThreadHandler() {
+        std::unordered_set<std::uint32_t> ready;
+        auto nextStatsSample = Clock::now();
+        while(running){
+            auto begin = Clock::now();
+            auto nodes = network->getNodes();
+            getNodesLatency.add(Clock::now() - begin);
+
+            std::unordered_set<std::uint32_t> present;
+            for(auto node : nodes){
+                present.insert(node.value);
+                if(ready.count(node.value) != 0){
+                    continue;
+                }
+                begin = Clock::now();
+                auto state = network->getNodeState(node);
+                getNodeStateLatency.add(Clock::now() - begin);
+                if((state != NodeState::Idle) && (state != NodeState::TaskLaunched)){
+                    continue;
+                }
+                ready.insert(node.value);
+                auto readyTime = Clock::now();
+                auto context = network->findNode(node);
+                if(context == nullptr){
+                    continue;
+                }
+                for(auto& task : context->getTasks()){
+                    auto device = parseIdentityTaskId(task);
+                    if(!device.has_value()){
+                        continue;
+                    }
+                    auto plugTime = provider->getPlugTime(device.value());
+                    if(plugTime.has_value()){
+                        hotplugToReady.add(readyTime - plugTime.value());
+                    }
+                }
+            }
+            for(auto it = ready.begin(); it != ready.end();){
+                it = (present.count(*it) == 0) ? ready.erase(it) : std::next(it);
+            }
+            readyNodes = ready.size();
+
+            begin = Clock::now();
+            network->getIdleNodesCount(EchoTaskId);
+            idleCountLatency.add(Clock::now() - begin);
+
+            if(Clock::now() >= nextStatsSample){
+                auto stats = readProcessStats();
+                maxThreads = std::max<std::size_t>(maxThreads, stats.threads);
+                maxRssKb = std::max<std::size_t>(maxRssKb, stats.rssKb);
+                nextStatsSample += std::chrono::milliseconds(100);
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    //Unplugs a random device every tick and plugs it back after DeviceDownTime
+    void churnThreadHandler() {
+        std::mt19937 random(1);
+        std::vector<std::uint32_t> plugged;
+        for(std::uint32_t i = 0; i < devices; ++i){
+            plugged.push_back(i);
+        }
+        std::deque<std::pair<std::uint32_t, Clock::time_point>> unplugged;
+        auto interval = std::chrono::duration_cast<Clock::duration>(std::chrono::seconds(1)) / std::max<std::uint32_t>(churnPerSecond, 1);
+        auto nextTick = Clock::now();
+        while(running){
+            nextTick += interval;
+            std::this_thread::sleep_until(nextTick);
+
+            if(!plugged.empty()){
+                auto index = std::uniform_int_distribution<std::size_t>(0, plugged.size() - 1)(random);
+                auto device = plugged[index];
+                plugged[index] = plugged.back();
+                plugged.pop_back();
+                auto begin = Clock::now();
+                provider->unplug(device);
+                unplugLatency.add(Clock::now() - begin);
+                unplugged.emplace_back(device, Clock::now());
+            }
+            while(!unplugged.empty() && (Clock::now() - unplugged.front().second >= DeviceDownTime)){
+                auto device = unplugged.front().first;
+                unplugged.pop_front();
+                auto begin = Clock::now();
+                provider->plug(device);
+                plugLatency.add(Clock::now() - begin);
+                plugged.push_back(device);
+                ++plugEvents;
+            }
+        }
+    }
+
+    //Runs short echo tasks on whatever node is idle, tasks die with unplugged devices
+    void workerThreadHandler() {
+        while(running){
+            auto state = std::make_shared<EchoState>();
+            auto obj = new EchoReceiver(state);
+            auto begin = Clock::now();
+            auto result = network->startTaskOnAnyNode(EchoTaskId, LFramework::makeComDelegate<MicroNetwork::Common::IDataReceiver>(obj, &EchoReceiver::onRelease));
+            startTaskLatency.add(Clock::now() - begin);
+            if(!result.has_value()){
+                ++startFailures;
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                continue;
+            }
+            bool completed = true;
+            for(std::uint32_t i = 0; running && (i < EchoPacketsPerTask); ++i){
+                MicroNetwork::Common::PacketHeader header;
+                header.id = EchoPacketId;
+                header.size = sizeof(i);
+                begin = Clock::now();
+                if(result->task->packet(header, &i) != LFramework::Result::Ok){
+                    completed = false;
+                    break;
+                }
+                if(!state->wait(i + 1)){
+                    ++echoTimeouts;
+                    completed = false;
+                    break;
+                }
+                echoLatency.add(Clock::now() - begin);
+            }
+            result->task = nullptr;
+            if(completed){
+                ++tasksCompleted;
+            }
+        }
+    }
+
+    bool waitReady(std::size_t count, std::chrono::seconds timeout) {
+        auto deadline = Clock::now() + timeout;
+        while(readyNodes < count){
+            if(Clock::now() > deadline){
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        return true;
+    }
+
+    int run() {
+        auto baseline = readProcessStats();
+        network = std::make_unique<Network>([this](ILinkCallback* callback){
+            provider = std::make_shared<EmulatedLinkProvider>(callback);
+            return provider;
+        });
+        std::thread monitorThread(&Benchmark::monitorThreadHandler, this);
+
+        //Population phase: connect every device once
+        auto begin = Clock::now();
+        for(std::uint32_t i = 0; i < devices; ++i){
+            auto plugBegin = Clock::now();
+            provider->plug(i);
+            plugLatency.add(Clock::now() - plugBegin);
+        }
+        if(!waitReady(devices, std::chrono::seconds(60))){
+            printf("Only %zu of %u nodes became ready\n", readyNodes.load(), devices);
+        }
+        auto populationTime = std::chrono::duration<double>(Clock::now() - begin).count();
+        auto populated = readProcessStats();
+
+        printf("Population: %u devices ready in %.3fs\n", devices, populationTime);
+        //Monitor thread and one emulated device thread per node are not part of host cost
+        printf("  threads: baseline %zu, populated %zu, host threads per node %.2f\n", baseline.threads, populated.threads,
+               (static_cast<double>(populated.threads) - baseline.threads - 1 - devices) / devices);
+        printf("  RSS: baseline %zu KiB, populated %zu KiB, per node %.1f KiB\n", baseline.rssKb, populated.rssKb,
+               (static_cast<double>(populated.rssKb) - baseline.rssKb) / devices);
+        plugLatency.print("plug (linksChanged)");
+        hotplugToReady.print("hotplug to ready");
+
+        //Churn phase
+        plugLatency.clear();
+        hotplugToReady.clear();
+        std::vector<std::thread> threads;
+        threads.emplace_back(&Benchmark::churnThreadHandler, this);
+        for(std::uint32_t i = 0; i < workers; ++i){
+            threads.emplace_back(&Benchmark::workerThreadHandler, this);
+        }
+        std::this_thread::sleep_for(std::chrono::seconds(seconds));
+        running = false;
+        for(auto& thread : threads){
+            thread.join();
+        }
+        monitorThread.join();
+
+        printf("Churn: %us, %u devices, %u unplugs/s, %u workers\n", seconds, devices, churnPerSecond, workers);
+        printf("  replugs %llu, tasks completed %llu (%.1f/s), start failures %llu, echo timeouts %llu\n",
+               static_cast<unsigned long long>(plugEvents.load()), static_cast<unsigned long long>(tasksCompleted.load()),
+               static_cast<double>(tasksCompleted) / seconds, static_cast<unsigned long long>(startFailures.load()),
+               static_cast<unsigned long long>(echoTimeouts.load()));
+        printf("  peak threads %zu, peak RSS %zu KiB\n", maxThreads.load(), maxRssKb.load());
+        plugLatency.print("plug (linksChanged)");
+        unplugLatency.print("unplug (linksChanged)");
+        hotplugToReady.print("hotplug to ready");
+        getNodesLatency.print("getNodes");
+        getNodeStateLatency.print("getNodeState");
+        idleCountLatency.print("getIdleNodesCount");
+        startTaskLatency.print("startTaskOnAnyNode");
+        echoLatency.print("echo round trip");
+
+        begin = Clock::now();
+        network = nullptr;
+        provider = nullptr;
+        printf("Shutdown: %.3fs\n", std::chrono::duration<double>(Clock::now() - begin).count());
+        return 0;
+    }
+};
+
+}
+
+int main(int argc, char** argv) {
+    Benchmark benchmark;
+    std::uint32_t* arguments[] = { &benchmark.devices, &benchmark.seconds, &benchmark.churnPerSecond, &benchmark.workers };
+    for(int i = 1; (i < argc) && (i <= 4); ++i){
+        *arguments[i - 1] = static_cast<std::uint32_t>(std::stoul(argv[i]));
+    }
+    if(benchmark.devices == 0){
+        printf("Usage: %s [devices] [seconds] [churnPerSecond] [workers]\n", argv[0]);
+        return 1;
+    }
+    return benchmark.run();
+}
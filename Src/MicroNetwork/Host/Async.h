@@ -0,0 +1,754 @@
+#pragma once
+
+#include <MicroNetwork.Common.h>
+#include <MicroNetwork/Common/Packet.h>
+#include <MicroNetwork/Host/Network.h>
+#include <MicroNetwork/Host/NodeContext.h>
+#include <MicroNetwork/Host/RxTimestamp.h>
+#include <MicroNetwork/Host/ITimestampedDataReceiver.h>
+#include <MicroNetwork/Host/LinkRingBuffer.h>
+#include <LFramework/Debug.h>
+#include <algorithm>
+#include <coroutine>
+#include <cstring>
+#include <condition_variable>
+#include <exception>
+#include <optional>
+#include <deque>
+#include <map>
+#include <unordered_set>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <tuple>
+#include <type_traits>
+
+//C++20 coroutine layer over Network/NodeContext.
+//Link threads never resume coroutines directly, all continuations are posted to Executor.
+
+namespace MicroNetwork::Host::Async {
+
+namespace Detail {
+
+//Scheduling state shared with everything that posts from link threads, so late wakeups after
+//Executor destruction are dropped instead of touching freed memory
+class ExecutorCore {
+public:
+    //Returns false once executor is shut down, handle is not resumed then
+    bool post(std::coroutine_handle<> handle) {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if(!_running){
+                return false;
+            }
+            _queue.push_back(handle);
+        }
+        _condition.notify_one();
+        return true;
+    }
+
+    bool postAfter(std::chrono::steady_clock::duration delay, std::coroutine_handle<> handle) {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if(!_running){
+                return false;
+            }
+            _timers.emplace(std::chrono::steady_clock::now() + delay, handle);
+        }
+        _condition.notify_one();
+        return true;
+    }
+
+    bool isRunning() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _running;
+    }
+
+    auto sleepFor(std::chrono::steady_clock::duration delay) {
+        struct SleepAwaiter {
+            ExecutorCore* executor;
+            std::chrono::steady_clock::duration delay;
+            bool await_ready() const noexcept { return delay <= std::chrono::steady_clock::duration::zero(); }
+            void await_suspend(std::coroutine_handle<> handle) { executor->postAfter(delay, handle); }
+            void await_resume() const noexcept {}
+        };
+        return SleepAwaiter{ this, delay };
+    }
+
+    auto schedule() {
+        struct ScheduleAwaiter {
+            ExecutorCore* executor;
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> handle) { executor->post(handle); }
+            void await_resume() const noexcept {}
+        };
+        return ScheduleAwaiter{ this };
+    }
+
+    //Spawned coroutines own the rest of their chain, destroying them on shutdown frees all frames
+    void addRoot(std::coroutine_handle<> handle) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _roots.insert(handle.address());
+    }
+
+    void removeRoot(std::coroutine_handle<> handle) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _roots.erase(handle.address());
+    }
+
+    void run() {
+        while(true){
+            std::coroutine_handle<> handle;
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                while(_queue.empty()){
+                    if(!_running){
+                        return;
+                    }
+                    if(_timers.empty()){
+                        _condition.wait(lock);
+                        continue;
+                    }
+                    auto due = _timers.begin()->first;
+                    if(due <= std::chrono::steady_clock::now()){
+                        _queue.push_back(_timers.begin()->second);
+                        _timers.erase(_timers.begin());
+                    }else{
+                        _condition.wait_until(lock, due);
+                    }
+                }
+                handle = _queue.front();
+                _queue.pop_front();
+            }
+            handle.resume();
+        }
+    }
+
+    void shutdown() {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _running = false;
+        }
+        _condition.notify_all();
+    }
+
+    //Called after worker threads are joined. Queued and timed handles point into spawned chains,
+    //they are dropped and the chains destroyed from their roots. Destructors run here may spawn again
+    void destroyFrames() {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _queue.clear();
+            _timers.clear();
+        }
+        while(true){
+            std::unordered_set<void*> roots;
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                roots.swap(_roots);
+            }
+            if(roots.empty()){
+                break;
+            }
+            for(auto root : roots){
+                std::coroutine_handle<>::from_address(root).destroy();
+            }
+        }
+    }
+private:
+    mutable std::mutex _mutex;
+    std::condition_variable _condition;
+    std::deque<std::coroutine_handle<>> _queue;
+    std::multimap<std::chrono::steady_clock::time_point, std::coroutine_handle<>> _timers;
+    std::unordered_set<void*> _roots;
+    bool _running = true;
+};
+
+}
+
+//Coroutines spawned on executor and still suspended when it is destroyed are destroyed with it.
+//Coroutines resumed on executor but not started by spawn are not resumed after destruction
+class Executor {
+public:
+    explicit Executor(std::size_t threadsCount = 1) : _core(std::make_shared<Detail::ExecutorCore>()) {
+        for(std::size_t i = 0; i < threadsCount; ++i){
+            _threads.emplace_back(&Detail::ExecutorCore::run, _core.get());
+        }
+    }
+
+    ~Executor() {
+        _core->shutdown();
+        for(auto& thread : _threads){
+            thread.join();
+        }
+        _core->destroyFrames();
+    }
+
+    void post(std::coroutine_handle<> handle) {
+        _core->post(handle);
+    }
+
+    void postAfter(std::chrono::steady_clock::duration delay, std::coroutine_handle<> handle) {
+        _core->postAfter(delay, handle);
+    }
+
+    auto sleepFor(std::chrono::steady_clock::duration delay) {
+        return _core->sleepFor(delay);
+    }
+
+    auto schedule() {
+        return _core->schedule();
+    }
+
+    const std::shared_ptr<Detail::ExecutorCore>& getCore() const {
+        return _core;
+    }
+private:
+    std::shared_ptr<Detail::ExecutorCore> _core;
+    std::vector<std::thread> _threads;
+};
+
+template<typename T = void>
+class Task;
+
+namespace Detail {
+
+class TaskPromiseBase {
+public:
+    struct FinalAwaiter {
+        bool await_ready() const noexcept { return false; }
+        template<typename TPromise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<TPromise> handle) noexcept {
+            auto continuation = handle.promise().continuation;
+            return continuation ? continuation : std::noop_coroutine();
+        }
+        void await_resume() const noexcept {}
+    };
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    FinalAwaiter final_suspend() noexcept { return {}; }
+    void unhandled_exception() { exception = std::current_exception(); }
+
+    std::coroutine_handle<> continuation;
+    std::exception_ptr exception;
+};
+
+template<typename T>
+class TaskPromise : public TaskPromiseBase {
+public:
+    Task<T> get_return_object();
+    void return_value(T v) { value = std::move(v); }
+    T result() {
+        if(exception){
+            std::rethrow_exception(exception);
+        }
+        return std::move(*value);
+    }
+    std::optional<T> value;
+};
+
+template<>
+class TaskPromise<void> : public TaskPromiseBase {
+public:
+    Task<void> get_return_object();
+    void return_void() {}
+    void result() {
+        if(exception){
+            std::rethrow_exception(exception);
+        }
+    }
+};
+
+}
+
+//Lazy coroutine, started when awaited
+template<typename T>
+class Task {
+public:
+    using promise_type = Detail::TaskPromise<T>;
+
+    explicit Task(std::coroutine_handle<promise_type> handle) : _handle(handle) {
+
+    }
+    Task(Task&& other) noexcept : _handle(std::exchange(other._handle, nullptr)) {
+
+    }
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+    ~Task() {
+        if(_handle){
+            _handle.destroy();
+        }
+    }
+
+    bool await_ready() const noexcept { return false; }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> continuation) {
+        _handle.promise().continuation = continuation;
+        return _handle;
+    }
+    T await_resume() {
+        return _handle.promise().result();
+    }
+private:
+    std::coroutine_handle<promise_type> _handle;
+};
+
+namespace Detail {
+
+template<typename T>
+inline Task<T> TaskPromise<T>::get_return_object() {
+    return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+}
+
+inline Task<void> TaskPromise<void>::get_return_object() {
+    return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+}
+
+struct DetachedTask {
+    struct promise_type {
+        //Receives coroutine arguments, registers frame as executor root until it completes
+        promise_type(const std::shared_ptr<ExecutorCore>& executor, Task<void>&) : executor(executor) {
+            executor->addRoot(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        ~promise_type() {
+            executor->removeRoot(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        DetachedTask get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() {
+            try {
+                std::rethrow_exception(std::current_exception());
+            } catch (const std::exception& ex) {
+                lfDebug() << "Unhandled exception in spawned task: " << ex.what();
+            } catch (...) {
+                lfDebug() << "Unhandled exception in spawned task";
+            }
+        }
+
+        std::shared_ptr<ExecutorCore> executor;
+    };
+};
+
+inline DetachedTask spawn(std::shared_ptr<ExecutorCore> executor, Task<void> task) {
+    co_await executor->schedule();
+    co_await std::move(task);
+}
+
+}
+
+//Run task on executor without waiting for result
+inline void spawn(Executor& executor, Task<void> task) {
+    Detail::spawn(executor.getCore(), std::move(task));
+}
+
+//Use as: while(auto item = co_await generator.next()) { ... }
+template<typename T>
+class AsyncGenerator {
+public:
+    struct promise_type {
+        struct YieldAwaiter {
+            bool await_ready() const noexcept { return false; }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> handle) noexcept {
+                return handle.promise().consumer;
+            }
+            void await_resume() const noexcept {}
+        };
+
+        AsyncGenerator get_return_object() { return AsyncGenerator(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        YieldAwaiter final_suspend() noexcept { return {}; }
+        YieldAwaiter yield_value(T value) {
+            current = std::move(value);
+            return {};
+        }
+        void return_void() {}
+        void unhandled_exception() { exception = std::current_exception(); }
+
+        std::optional<T> current;
+        std::coroutine_handle<> consumer;
+        std::exception_ptr exception;
+    };
+
+    explicit AsyncGenerator(std::coroutine_handle<promise_type> handle) : _handle(handle) {
+
+    }
+    AsyncGenerator(AsyncGenerator&& other) noexcept : _handle(std::exchange(other._handle, nullptr)) {
+
+    }
+    AsyncGenerator(const AsyncGenerator&) = delete;
+    AsyncGenerator& operator=(const AsyncGenerator&) = delete;
+    ~AsyncGenerator() {
+        if(_handle){
+            _handle.destroy();
+        }
+    }
+
+    auto next() {
+        struct NextAwaiter {
+            std::coroutine_handle<promise_type> handle;
+            bool await_ready() const noexcept { return handle.done(); }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> consumer) {
+                handle.promise().consumer = consumer;
+                return handle;
+            }
+            std::optional<T> await_resume() {
+                auto& promise = handle.promise();
+                if(promise.exception){
+                    std::rethrow_exception(std::exchange(promise.exception, nullptr));
+                }
+                return std::exchange(promise.current, std::nullopt);
+            }
+        };
+        return NextAwaiter{ _handle };
+    }
+private:
+    std::coroutine_handle<promise_type> _handle;
+};
+
+struct TimestampedPacket {
+    Common::MaxPacket packet;
+    RxClock::time_point rxTimestamp;
+};
+
+class TaskSession : public std::enable_shared_from_this<TaskSession> {
+public:
+    static constexpr std::size_t DefaultReceiveQueueSize = 64 * 1024;
+
+    //Received packets are queued up to receiveQueueSize bytes. When the queue is full link RX thread
+    //waits for the consumer, which stalls the other nodes on the same link as a slow IDataReceiver would
+    TaskSession(Executor& executor, std::shared_ptr<NodeContext> node, std::size_t receiveQueueSize = DefaultReceiveQueueSize)
+        : _executor(executor.getCore()), _node(node), _state(std::make_shared<State>(receiveQueueSize)) {
+        _state->executor = _executor;
+    }
+
+    ~TaskSession() {
+        stop();
+    }
+
+    bool isConnected() const {
+        std::lock_guard<std::mutex> lock(_state->mutex);
+        return _state->connected;
+    }
+
+    //Releases task handle, node is requested to stop the task. Packets already queued can still be received.
+    //Does not wait for link TX space: if it is full, TaskStop is written from executor once link drains.
+    //After executor is destroyed the handle is released right away and TaskStop is written blocking
+    void stop() {
+        //Blocked link RX thread holds task lock which releasing the handle takes
+        _state->stopConsuming();
+        auto task = std::exchange(_task, nullptr);
+        auto tx = std::move(_tx);
+        _tx = nullptr;
+        if((task == nullptr) || (task->tryStop() != TxStatus::WouldBlock) || !_executor->isRunning()){
+            return;
+        }
+        Detail::spawn(_executor, stopWhenWritable(_executor, _node, task, tx));
+    }
+
+    //Suspends while link TX buffer is full or task is rate limited. Data must stay valid until send completes
+    Task<bool> send(Common::PacketHeader header, const void* data) {
+        while(true){
+            auto epoch = _node->getTxEpoch();
+            auto status = trySend(header, data);
+            if(status == TxStatus::Throttled){
+                co_await _executor->sleepFor(_node->getTxThrottleDelay(header));
+            }else if(status == TxStatus::WouldBlock){
+                co_await TxAvailableAwaiter{ _node.get(), _executor, epoch };
+            }else{
+                co_return status == TxStatus::Ok;
+            }
+        }
+    }
+
+    //Returns std::nullopt when task is stopped or link disconnected. Single consumer only
+    auto receive() {
+        return ReceiveAwaiter<Common::MaxPacket>{ _state };
+    }
+
+    //Same as receive, packet carries link receive time (see ITimestampedDataReceiver)
+    auto receiveTimestamped() {
+        return ReceiveAwaiter<TimestampedPacket>{ _state };
+    }
+
+    //Session is captured here, generator body runs lazily and may outlive caller's reference
+    AsyncGenerator<Common::MaxPacket> packets() {
+        return packetsImpl(shared_from_this());
+    }
+
+    static Task<std::shared_ptr<TaskSession>> start(Executor& executor, std::shared_ptr<NodeContext> node, LFramework::Guid taskId,
+                                                    std::size_t receiveQueueSize = DefaultReceiveQueueSize) {
+        if(node == nullptr){
+            co_return nullptr;
+        }
+        auto session = std::make_shared<TaskSession>(executor, node, receiveQueueSize);
+        //Releasing receiver closes session, so keep the same one across retries
+        auto receiver = session->makeReceiver();
+        while(true){
+            auto epoch = node->getTxEpoch();
+            TaskStartAwaiter startAwaiter{ node.get(), session->_executor, taskId, receiver };
+            auto [status, tx, context] = co_await startAwaiter;
+            if(status == TaskStartStatus::Rejected){
+                co_return nullptr;
+            }
+            if(status == TaskStartStatus::Pending){
+                if(tx == nullptr){
+                    co_return nullptr;
+                }
+                session->_tx = tx;
+                session->_task = context;
+                co_return session;
+            }
+            co_await TxAvailableAwaiter{ node.get(), session->_executor, epoch };
+        }
+    }
+private:
+    //Holds task handle until TaskStop is written, so releasing it does not block
+    static Task<void> stopWhenWritable(std::shared_ptr<Detail::ExecutorCore> executor, std::shared_ptr<NodeContext> node,
+                                       TaskContext* task, LFramework::ComPtr<Common::IDataReceiver> tx) {
+        while(true){
+            auto epoch = node->getTxEpoch();
+            if(task->tryStop() != TxStatus::WouldBlock){
+                co_return;
+            }
+            co_await TxAvailableAwaiter{ node.get(), executor, epoch };
+        }
+    }
+
+    static AsyncGenerator<Common::MaxPacket> packetsImpl(std::shared_ptr<TaskSession> self) {
+        while(auto packet = co_await self->receive()){
+            co_yield std::move(*packet);
+        }
+    }
+
+    struct State {
+        //Queue record, followed by payload
+        struct QueuedPacket {
+            Common::PacketHeader header;
+            RxClock::time_point rxTimestamp;
+        };
+
+        //Queue always fits at least one full packet
+        State(std::size_t queueSize) : packets(std::max(queueSize, sizeof(QueuedPacket) + sizeof(Common::MaxPacket)), false) {
+
+        }
+
+        mutable std::mutex mutex;
+        std::condition_variable space;
+        LinkRingBuffer packets;
+        std::coroutine_handle<> waiter;
+        bool connected = true;
+        bool consuming = true;
+        std::shared_ptr<Detail::ExecutorCore> executor;
+
+        bool isReadable() const {
+            return (packets.bytesAvailable() != 0) || !connected;
+        }
+
+        void push(Common::PacketHeader header, const void* data, RxClock::time_point rxTimestamp) {
+            QueuedPacket queued{ header, rxTimestamp };
+            if(data == nullptr){
+                queued.header.size = 0;
+            }
+            auto recordSize = sizeof(queued) + queued.header.size;
+            std::coroutine_handle<> handle;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                //Backpressure: wait for consumer instead of queueing without bound
+                space.wait(lock, [&]{ return !consuming || (packets.getCapacity() - packets.bytesAvailable() >= recordSize); });
+                if(!consuming){
+                    return;
+                }
+                packets.write(&queued, sizeof(queued));
+                packets.write(data, queued.header.size);
+                handle = std::exchange(waiter, nullptr);
+            }
+            if(handle){
+                executor->post(handle);
+            }
+        }
+
+        //Called with mutex held and a record available
+        TimestampedPacket pop() {
+            QueuedPacket queued;
+            read(&queued, sizeof(queued));
+            TimestampedPacket item;
+            item.packet.header = queued.header;
+            item.rxTimestamp = queued.rxTimestamp;
+            read(item.packet.payload.data(), queued.header.size);
+            return item;
+        }
+
+        //Consumer is gone, pending and further packets are dropped instead of waiting for space
+        void stopConsuming() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                consuming = false;
+            }
+            space.notify_all();
+        }
+
+        void close() {
+            std::coroutine_handle<> handle;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                connected = false;
+                handle = std::exchange(waiter, nullptr);
+            }
+            if(handle){
+                executor->post(handle);
+            }
+        }
+    private:
+        void read(void* data, std::size_t size) {
+            auto output = static_cast<std::uint8_t*>(data);
+            while(size != 0){
+                std::size_t regionSize = 0;
+                auto region = packets.readRegion(regionSize);
+                regionSize = std::min(regionSize, size);
+                memcpy(output, region, regionSize);
+                packets.consume(regionSize);
+                output += regionSize;
+                size -= regionSize;
+            }
+        }
+    };
+
+    class Receiver : public LFramework::RefCountedObject {
+    public:
+        Receiver(std::shared_ptr<State> state) : _state(state) {
+
+        }
+        LFramework::Result packet(Common::PacketHeader header, const void* data) {
+            _state->push(header, data, RxClock::now());
+            return LFramework::Result::Ok;
+        }
+        LFramework::Result timestampedPacket(Common::PacketHeader header, const void* data, RxClock::time_point rxTimestamp) {
+            _state->push(header, data, rxTimestamp);
+            return LFramework::Result::Ok;
+        }
+        void onRelease() {
+            _state->close();
+        }
+    private:
+        std::shared_ptr<State> _state;
+    };
+
+    template<typename TResult>
+    struct ReceiveAwaiter {
+        std::shared_ptr<State> state;
+        bool await_ready() const {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            return state->isReadable();
+        }
+        bool await_suspend(std::coroutine_handle<> handle) {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if(state->isReadable()){
+                return false;
+            }
+            state->waiter = handle;
+            return true;
+        }
+        std::optional<TResult> await_resume() {
+            TimestampedPacket item;
+            {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                if(state->packets.bytesAvailable() == 0){
+                    return std::nullopt;
+                }
+                item = state->pop();
+            }
+            state->space.notify_one();
+            if constexpr (std::is_same_v<TResult, TimestampedPacket>){
+                return item;
+            }else{
+                return item.packet;
+            }
+        }
+    };
+
+    struct TxAvailableAwaiter {
+        NodeContext* node;
+        std::shared_ptr<Detail::ExecutorCore> executor;
+        std::uint32_t epoch;
+        bool await_ready() const noexcept { return false; }
+        bool await_suspend(std::coroutine_handle<> handle) {
+            auto executor = this->executor;
+            return node->subscribeTxAvailable(epoch, [executor, handle](){ executor->post(handle); });
+        }
+        void await_resume() const noexcept {}
+    };
+
+    struct TaskStartAwaiter {
+        //Shared with completion, which may run on link thread after awaiting frame is destroyed
+        struct Completion {
+            std::shared_ptr<Detail::ExecutorCore> executor;
+            std::coroutine_handle<> handle;
+            LFramework::ComPtr<Common::IDataReceiver> result;
+            TaskContext* context = nullptr;
+        };
+
+        NodeContext* node;
+        std::shared_ptr<Detail::ExecutorCore> executor;
+        LFramework::Guid taskId;
+        LFramework::ComPtr<Common::IDataReceiver> receiver;
+        TaskStartStatus status = TaskStartStatus::Pending;
+        std::shared_ptr<Completion> completion;
+
+        bool await_ready() const noexcept { return false; }
+        bool await_suspend(std::coroutine_handle<> handle) {
+            completion = std::make_shared<Completion>();
+            completion->executor = executor;
+            completion->handle = handle;
+            //Completion may resume coroutine before startTaskAsync returns, do not touch 'this' after Pending
+            auto startStatus = node->startTaskAsync(taskId, receiver, [completion = completion](LFramework::ComPtr<Common::IDataReceiver> tx, TaskContext* context){
+                completion->result = tx;
+                completion->context = context;
+                if(!completion->executor->post(completion->handle)){
+                    //Executor is gone, nobody will take the task, releasing it stops the task
+                    completion->result = nullptr;
+                }
+            });
+            if(startStatus == TaskStartStatus::Pending){
+                return true;
+            }
+            status = startStatus;
+            return false;
+        }
+        std::tuple<TaskStartStatus, LFramework::ComPtr<Common::IDataReceiver>, TaskContext*> await_resume() {
+            if(status != TaskStartStatus::Pending){
+                return { status, nullptr, nullptr };
+            }
+            return { status, std::exchange(completion->result, nullptr), completion->context };
+        }
+    };
+
+    LFramework::ComPtr<Common::IDataReceiver> makeReceiver() {
+        auto obj = new Receiver(_state);
+        return LFramework::makeComDelegate<ITimestampedDataReceiver>(obj, &Receiver::onRelease).queryInterface<Common::IDataReceiver>();
+    }
+
+    //Goes through task handle, so packets are refused once the task is stopped or released
+    TxStatus trySend(Common::PacketHeader header, const void* data) {
+        if(_task == nullptr || !isConnected()){
+            return TxStatus::Closed;
+        }
+        return _task->tryPacket(header, data);
+    }
+
+    std::shared_ptr<Detail::ExecutorCore> _executor;
+    std::shared_ptr<NodeContext> _node;
+    std::shared_ptr<State> _state;
+    LFramework::ComPtr<Common::IDataReceiver> _tx;
+    //Kept alive by _tx
+    TaskContext* _task = nullptr;
+};
+
+inline Task<std::shared_ptr<TaskSession>> startTask(Executor& executor, Network& network, NodeHandle node, LFramework::Guid taskId,
+                                                    std::size_t receiveQueueSize = TaskSession::DefaultReceiveQueueSize) {
+    return TaskSession::start(executor, network.findNode(node), taskId, receiveQueueSize);
+}
+
+}
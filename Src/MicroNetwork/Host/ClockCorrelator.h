@@ -0,0 +1,113 @@
+#pragma once
+
+#include <MicroNetwork/Host/RxTimestamp.h>
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+namespace MicroNetwork::Host {
+
+//Estimates device clock offset and drift from ping exchanges done by a task:
+//host sends ping at hostSend, device replies with its tick counter, reply is received at hostReceive.
+//Fits hostTime = offset + scale * deviceTicks over round trips close to the fastest one
+class ClockCorrelator {
+public:
+    ClockCorrelator(double deviceTicksPerSecond, std::size_t windowSize = 32) : _ticksPerSecond(deviceTicksPerSecond), _windowSize(windowSize) {
+
+    }
+
+    void addSample(RxClock::time_point hostSend, std::uint64_t deviceTicks, RxClock::time_point hostReceive) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if(!_hasEpoch){
+            _hostEpoch = hostSend;
+            _deviceEpoch = deviceTicks;
+            _hasEpoch = true;
+        }
+        Sample sample;
+        sample.roundTrip = std::chrono::duration<double>(hostReceive - hostSend).count();
+        sample.hostTime = std::chrono::duration<double>(hostSend - _hostEpoch).count() + sample.roundTrip / 2;
+        sample.deviceTime = static_cast<double>(static_cast<std::int64_t>(deviceTicks - _deviceEpoch)) / _ticksPerSecond;
+        _samples.push_back(sample);
+        if(_samples.size() > _windowSize){
+            _samples.pop_front();
+        }
+        fit();
+    }
+
+    bool isValid() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return !_samples.empty();
+    }
+
+    RxClock::time_point toHostTime(std::uint64_t deviceTicks) const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto deviceTime = static_cast<double>(static_cast<std::int64_t>(deviceTicks - _deviceEpoch)) / _ticksPerSecond;
+        auto hostTime = _offset + _scale * deviceTime;
+        return _hostEpoch + std::chrono::duration_cast<RxClock::duration>(std::chrono::duration<double>(hostTime));
+    }
+
+    //Positive when device clock runs slow relative to host
+    double getDriftPpm() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return (_scale - 1.0) * 1e6;
+    }
+
+    std::chrono::duration<double> getMinRoundTrip() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return std::chrono::duration<double>(_minRoundTrip);
+    }
+private:
+    struct Sample {
+        double hostTime;
+        double deviceTime;
+        double roundTrip;
+    };
+
+    void fit() {
+        _minRoundTrip = _samples.front().roundTrip;
+        for(auto& sample : _samples){
+            _minRoundTrip = std::min(_minRoundTrip, sample.roundTrip);
+        }
+        //Samples delayed by scheduling or bus traffic have asymmetric path delay, skip them
+        auto threshold = _minRoundTrip * 1.5 + 20e-6;
+
+        double count = 0;
+        double sumDevice = 0;
+        double sumHost = 0;
+        for(auto& sample : _samples){
+            if(sample.roundTrip <= threshold){
+                count += 1;
+                sumDevice += sample.deviceTime;
+                sumHost += sample.hostTime;
+            }
+        }
+        auto meanDevice = sumDevice / count;
+        auto meanHost = sumHost / count;
+
+        double covariance = 0;
+        double variance = 0;
+        for(auto& sample : _samples){
+            if(sample.roundTrip <= threshold){
+                covariance += (sample.deviceTime - meanDevice) * (sample.hostTime - meanHost);
+                variance += (sample.deviceTime - meanDevice) * (sample.deviceTime - meanDevice);
+            }
+        }
+        //Drift is not observable until samples span some time
+        _scale = (variance > 1e-6) ? covariance / variance : 1.0;
+        _offset = meanHost - _scale * meanDevice;
+    }
+
+    mutable std::mutex _mutex;
+    double _ticksPerSecond;
+    std::size_t _windowSize;
+    std::deque<Sample> _samples;
+    bool _hasEpoch = false;
+    RxClock::time_point _hostEpoch;
+    std::uint64_t _deviceEpoch = 0;
+    double _offset = 0;
+    double _scale = 1.0;
+    double _minRoundTrip = 0;
+};
+
+}
@@ -0,0 +1,215 @@
+#pragma once
+
+#include <MicroNetwork/Host/LinkProvider.h>
+#include <MicroNetwork/Host/ShmRing.h>
+#include <MicroNetwork/Host/DaemonProtocol.h>
+#include <MicroNetwork/Host/RxTimestamp.h>
+#include <MicroNetwork/Common/DataStream.h>
+#include <MicroNetwork/Common/Packet.h>
+#include <LFramework/Threading/Semaphore.h>
+#include <LFramework/Debug.h>
+#include <atomic>
+#include <thread>
+#include <functional>
+#include <vector>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace MicroNetwork::Host {
+
+//Link stream served by LinkDaemon: packet bytes go through shared memory rings,
+//socket is only used to detect that the other side is gone
+class DaemonStream : public Common::DataStream, public IRxTimestampSource {
+public:
+    DaemonStream(int fd, std::shared_ptr<ShmRing> txRing, std::shared_ptr<ShmRing> rxRing) : _fd(fd), _txRing(txRing), _rxRing(rxRing) {
+
+    }
+
+    ~DaemonStream() {
+        cancel();
+        if(_rxThread.joinable()){
+            _rxThread.join();
+        }
+        if(_txThread.joinable()){
+            _txThread.join();
+        }
+        if(_monitorThread.joinable()){
+            _monitorThread.join();
+        }
+        ::close(_fd);
+    }
+
+    bool start() override {
+        reset();
+        _running = true;
+
+        _rxThread = std::thread(std::bind(&DaemonStream::rxThreadHandler, this));
+        _txThread = std::thread(std::bind(&DaemonStream::txThreadHandler, this));
+        _monitorThread = std::thread(std::bind(&DaemonStream::monitorThreadHandler, this));
+        return true;
+    }
+
+    RxClock::time_point getLastRxTimestamp() const override {
+        return RxClock::time_point(RxClock::duration(_lastRxTimestamp.load()));
+    }
+
+    void cancel() {
+        _running = false;
+        _txRing->close();
+        _rxRing->close();
+        shutdown(_fd, SHUT_RDWR);
+        _rxJob.give();
+        _txJob.give();
+    }
+private:
+    void onRemoteDisconnect() override {
+        cancel();
+    }
+    void onRemoteReset() override {
+
+    }
+    void onRemoteDataAvailable() override {
+        _txJob.give();
+    }
+    void onReadBytes() override {
+        _rxJob.give();
+    }
+
+    //Packets are handed to Host one at a time with the daemon's receive time published first,
+    //so each one is stamped when it came off the real link rather than when it left the ring
+    void rxThreadHandler() {
+        Common::MaxPacket packet;
+        DaemonProtocol::RxRecordHeader record;
+        while(_running){
+            if(!_rxRing->readAll(&record, sizeof(record)) || !_rxRing->readAll(&packet.header, sizeof(packet.header))){
+                break;
+            }
+            if(packet.header.size > packet.payload.size()){
+                lfDebug() << "Daemon link: invalid packet size " << packet.header.size;
+                break;
+            }
+            if(!_rxRing->readAll(packet.payload.data(), packet.header.size)){
+                break;
+            }
+            _lastRxTimestamp = record.rxTimestamp;
+            auto rxData = reinterpret_cast<const std::uint8_t*>(&packet);
+            auto rxSize = sizeof(packet.header) + packet.header.size;
+            std::size_t doneRxSize = 0;
+            while(true){
+                doneRxSize += write(rxData + doneRxSize, rxSize - doneRxSize);
+                if(_running && (doneRxSize != rxSize)){
+                    _rxJob.take();
+                }else{
+                    break;
+                }
+            }
+        }
+        _running = false;
+        notifyDisconnect();
+    }
+
+    void txThreadHandler() {
+        std::vector<std::uint8_t> txBuffer(4096);
+        while(_running){
+            _txJob.take();
+            while(_running){
+                auto size = _remote->read(txBuffer.data(), txBuffer.size());
+                if(size == 0){
+                    break;
+                }
+                if(!_txRing->writeAll(txBuffer.data(), size)){
+                    _running = false;
+                }
+            }
+        }
+        notifyDisconnect();
+    }
+
+    void monitorThreadHandler() {
+        while(DaemonProtocol::receiveMessage(_fd).has_value()){
+
+        }
+        cancel();
+    }
+
+    int _fd;
+    std::shared_ptr<ShmRing> _txRing;
+    std::shared_ptr<ShmRing> _rxRing;
+    std::atomic<bool> _running = false;
+    std::atomic<RxClock::rep> _lastRxTimestamp = 0;
+    std::thread _rxThread;
+    std::thread _txThread;
+    std::thread _monitorThread;
+    LFramework::Threading::BinarySemaphore _rxJob;
+    LFramework::Threading::BinarySemaphore _txJob;
+};
+
+//Client side of LinkDaemon, use with Network(providerConstructor)
+class DaemonLinkProvider : public LinkProvider {
+public:
+    DaemonLinkProvider(std::string socketPath, ILinkCallback* linkCallback) : LinkProvider(linkCallback), _socketPath(socketPath) {
+        _eventsFd = DaemonProtocol::connectSocket(socketPath);
+        if(!DaemonProtocol::sendMessage(_eventsFd, { DaemonProtocol::MessageId::Subscribe, {} })){
+            ::close(_eventsFd);
+            throw std::runtime_error("Failed to subscribe to link daemon events");
+        }
+        _eventsThread = std::thread(&DaemonLinkProvider::eventsThreadHandler, this);
+    }
+
+    ~DaemonLinkProvider() {
+        shutdown(_eventsFd, SHUT_RDWR);
+        _eventsThread.join();
+        ::close(_eventsFd);
+    }
+private:
+    std::vector<std::string> getLinks() override {
+        try {
+            auto fd = DaemonProtocol::connectSocket(_socketPath);
+            std::optional<DaemonProtocol::Message> response;
+            if(DaemonProtocol::sendMessage(fd, { DaemonProtocol::MessageId::GetLinks, {} })){
+                response = DaemonProtocol::receiveMessage(fd);
+            }
+            ::close(fd);
+            if(response.has_value() && (response->id == DaemonProtocol::MessageId::Links)){
+                return response->values;
+            }
+        } catch (const std::exception& ex) {
+            lfDebug() << "Failed to get daemon links: " << ex.what();
+        }
+        return {};
+    }
+
+    std::shared_ptr<Common::DataStream> makeStream(const std::string& linkPath) override {
+        auto fd = DaemonProtocol::connectSocket(_socketPath);
+        std::optional<DaemonProtocol::Message> response;
+        if(DaemonProtocol::sendMessage(fd, { DaemonProtocol::MessageId::OpenLink, { linkPath } })){
+            response = DaemonProtocol::receiveMessage(fd);
+        }
+        if(!response.has_value() || (response->id != DaemonProtocol::MessageId::LinkOpened) || (response->values.size() != 2)){
+            ::close(fd);
+            throw std::runtime_error("Link daemon refused to open " + linkPath);
+        }
+        try {
+            auto txRing = ShmRing::open(response->values[0]);
+            auto rxRing = ShmRing::open(response->values[1]);
+            return std::make_shared<DaemonStream>(fd, txRing, rxRing);
+        } catch (...) {
+            ::close(fd);
+            throw;
+        }
+    }
+
+    void eventsThreadHandler() {
+        while(auto message = DaemonProtocol::receiveMessage(_eventsFd)){
+            if(message->id == DaemonProtocol::MessageId::LinksChanged){
+                onLinksUpdated();
+            }
+        }
+    }
+
+    std::string _socketPath;
+    int _eventsFd = -1;
+    std::thread _eventsThread;
+};
+
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <optional>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+//Control protocol between LinkDaemon and DaemonLinkProvider.
+//One SOCK_SEQPACKET message per request/notification: 4 byte id followed by '\n' separated strings.
+//Packet data never goes through the socket, it uses ShmRing pair per opened link.
+
+namespace MicroNetwork::Host::DaemonProtocol {
+
+enum class MessageId : std::uint32_t {
+    GetLinks,
+    Links,
+    Subscribe,
+    LinksChanged,
+    OpenLink,
+    LinkOpened,
+    LinkFailed
+};
+
+struct Message {
+    MessageId id;
+    std::vector<std::string> values;
+};
+
+constexpr std::size_t MaxMessageSize = 64 * 1024;
+
+//Daemon to client ring carries this before every packet: time the daemon received the packet from
+//the real link in steady_clock ticks. steady_clock is system-wide, so client publishes it as is
+struct RxRecordHeader {
+    std::int64_t rxTimestamp;
+};
+
+inline sockaddr_un makeAddress(const std::string& socketPath) {
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if(socketPath.size() >= sizeof(address.sun_path)){
+        throw std::runtime_error("Socket path too long: " + socketPath);
+    }
+    memcpy(address.sun_path, socketPath.c_str(), socketPath.size());
+    return address;
+}
+
+inline int connectSocket(const std::string& socketPath) {
+    auto address = makeAddress(socketPath);
+    auto fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if(fd < 0){
+        throw std::runtime_error("Failed to create socket");
+    }
+    if(connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0){
+        ::close(fd);
+        throw std::runtime_error("Failed to connect to link daemon: " + socketPath);
+    }
+    return fd;
+}
+
+inline bool sendMessage(int fd, const Message& message, int flags = 0) {
+    std::vector<char> buffer(sizeof(message.id));
+    memcpy(buffer.data(), &message.id, sizeof(message.id));
+    for(std::size_t i = 0; i < message.values.size(); ++i){
+        if(i != 0){
+            buffer.push_back('\n');
+        }
+        buffer.insert(buffer.end(), message.values[i].begin(), message.values[i].end());
+    }
+    if(buffer.size() > MaxMessageSize){
+        return false;
+    }
+    return send(fd, buffer.data(), buffer.size(), MSG_NOSIGNAL | flags) == static_cast<ssize_t>(buffer.size());
+}
+
+//Blocking, returns std::nullopt when connection is closed
+inline std::optional<Message> receiveMessage(int fd) {
+    std::vector<char> buffer(MaxMessageSize);
+    auto size = recv(fd, buffer.data(), buffer.size(), 0);
+    if(size < static_cast<ssize_t>(sizeof(MessageId))){
+        return std::nullopt;
+    }
+    Message result;
+    memcpy(&result.id, buffer.data(), sizeof(result.id));
+    std::string payload(buffer.data() + sizeof(MessageId), buffer.data() + size);
+    std::size_t start = 0;
+    while(start < payload.size()){
+        auto end = payload.find('\n', start);
+        if(end == std::string::npos){
+            end = payload.size();
+        }
+        result.values.push_back(payload.substr(start, end - start));
+        start = end + 1;
+    }
+    return result;
+}
+
+}
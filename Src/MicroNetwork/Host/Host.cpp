@@ -11,38 +11,157 @@ LFramework::ComPtr<Common::IDataReceiver> NodeContext::startTask(LFramework::Gui
     auto a1 = userDataReceiver->release();
 
 
+    auto constructor = std::make_shared<TaskContextConstructor>();
     {
         std::lock_guard<std::recursive_mutex> lock(_taskMutex);
         if((_currentTask != nullptr) || (_nextTask != nullptr)){
             return nullptr;
         }
-        _nextTask = std::make_shared<TaskContextConstructor>();
+        _nextTask = constructor;
+        setCurrentTaskId(taskId);
+        notifyStateChanged();
     }
 
     Common::MaxPacket packet;
     packet.header.id = Common::PacketId::TaskStart;
     packet.setData(taskId);
     //lfDebug() << "Sending task start...";
-    _host->blockingWritePacket(packet.header, packet.payload.data());
+    bool sent = false;
+    {
+        //Host must not stay pinned while waiting for response, link disconnect finalizes it
+        HostRef host(*this);
+        sent = (host != nullptr) && host->blockingWritePacket(packet.header, packet.payload.data());
+    }
+    if(!sent){
+        std::lock_guard<std::recursive_mutex> lock(_taskMutex);
+        if(_nextTask == constructor){
+            _nextTask = nullptr;
+            notifyStateChanged();
+        }
+        return nullptr;
+    }
 
-    bool started = _nextTask->wait();
+    //Local reference: link disconnect clears _nextTask and finalizes it
+    bool started = constructor->wait();
 
     std::lock_guard<std::recursive_mutex> lock(_taskMutex);
-    _nextTask = nullptr;
-    if(!started) {
+    if(_nextTask == constructor){
+        _nextTask = nullptr;
+    }
+    if(!started || (_host == nullptr)) {
+        notifyStateChanged();
         return nullptr;
     }else{
-        _currentTask.reset();
-        auto obj = new TaskContext(this);
-        _currentTask = LFramework::makeComDelegate<ITaskContext>(obj, &TaskContext::onNetworkRelease);
-        _currentTask->setUserDataReceiver(userDataReceiver);
-        return LFramework::makeComDelegate<Common::IDataReceiver>(obj, &TaskContext::onUserRelease);
+        return createTaskContext(userDataReceiver);
     }
 }
 
+TaskStartStatus NodeContext::startTaskAsync(LFramework::Guid taskId, LFramework::ComPtr<Common::IDataReceiver> userDataReceiver,
+                                            std::function<void(LFramework::ComPtr<Common::IDataReceiver>, TaskContext*)> completion) {
+    HostRef host(*this);
+    if ((host == nullptr) || !isReady()) {
+        return TaskStartStatus::Rejected;
+    }
+
+    auto constructor = std::make_shared<TaskContextConstructor>([this, userDataReceiver, completion](bool started){
+        LFramework::ComPtr<Common::IDataReceiver> result;
+        TaskContext* context = nullptr;
+        {
+            std::lock_guard<std::recursive_mutex> lock(_taskMutex);
+            _nextTask = nullptr;
+            if(started){
+                result = createTaskContext(userDataReceiver, &context);
+            }else{
+                notifyStateChanged();
+            }
+        }
+        completion(result, context);
+    });
+
+    {
+        std::lock_guard<std::recursive_mutex> lock(_taskMutex);
+        if((_currentTask != nullptr) || (_nextTask != nullptr)){
+            return TaskStartStatus::Rejected;
+        }
+        _nextTask = constructor;
+        setCurrentTaskId(taskId);
+        notifyStateChanged();
+    }
+
+    Common::MaxPacket packet;
+    packet.header.id = Common::PacketId::TaskStart;
+    packet.setData(taskId);
+    //Write outside of task lock: TaskStart response is handled on link thread under the same lock
+    auto writeStatus = host->tryWritePacket(packet.header, packet.payload.data());
+    if(writeStatus != WriteStatus::Ok){
+        if(!constructor->cancel()){
+            //Finalized by concurrent link disconnect, completion has reported the failure
+            return TaskStartStatus::Pending;
+        }
+        std::lock_guard<std::recursive_mutex> lock(_taskMutex);
+        if(_nextTask == constructor){
+            _nextTask = nullptr;
+            notifyStateChanged();
+        }
+        //Closed host never drains, retrying would spin until link disconnect detaches the node
+        return (writeStatus == WriteStatus::Closed) ? TaskStartStatus::Rejected : TaskStartStatus::WouldBlock;
+    }
+    return TaskStartStatus::Pending;
+}
+
+LFramework::ComPtr<Common::IDataReceiver> NodeContext::createTaskContext(LFramework::ComPtr<Common::IDataReceiver> userDataReceiver, TaskContext** context) {
+    _currentTask.reset();
+    auto obj = new TaskContext(this);
+    if(context != nullptr){
+        *context = obj;
+    }
+    _currentTask = LFramework::makeComDelegate<ITaskContext>(obj, &TaskContext::onNetworkRelease);
+    _currentTask->setUserDataReceiver(userDataReceiver);
+    notifyStateChanged();
+    return LFramework::makeComDelegate<Common::IDataReceiver>(obj, &TaskContext::onUserRelease);
+}
+
 
 bool NodeContext::handleUserPacket(Common::PacketHeader header, const void* data) {
-    return _host->blockingWritePacket(header, data);
+    HostRef host(*this);
+    if(host == nullptr){
+        return false;
+    }
+    return host->blockingWritePacket(header, data);
+}
+
+TxStatus NodeContext::tryHandleUserPacket(Common::PacketHeader header, const void* data) {
+    HostRef host(*this);
+    if(host == nullptr){
+        return TxStatus::Closed;
+    }
+    //TaskStop is not shaped, same as in TaskContext::packet
+    auto shaper = (header.id != Common::PacketId::TaskStop) ? getCurrentTaskShaper() : nullptr;
+    auto packetSize = static_cast<std::uint32_t>(sizeof(header) + header.size);
+    if((shaper != nullptr) && !shaper->tryConsume(packetSize)){
+        return TxStatus::Throttled;
+    }
+    auto writeStatus = host->tryWritePacket(header, data);
+    if(writeStatus != WriteStatus::Ok){
+        if(shaper != nullptr){
+            shaper->refund(packetSize);
+        }
+        return (writeStatus == WriteStatus::Closed) ? TxStatus::Closed : TxStatus::WouldBlock;
+    }
+    return TxStatus::Ok;
+}
+
+std::uint32_t NodeContext::getTxEpoch() const {
+    HostRef host(*this);
+    return host == nullptr ? 0 : host->getTxEpoch();
+}
+
+bool NodeContext::subscribeTxAvailable(std::uint32_t epoch, std::function<void()> callback) {
+    HostRef host(*this);
+    if(host == nullptr){
+        return false;
+    }
+    return host->subscribeTxAvailable(epoch, std::move(callback));
 }
 
 
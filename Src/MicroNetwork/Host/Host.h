@@ -15,6 +15,9 @@
 #include <LFramework/Debug.h>
 #include <LFramework/Guid.h>
 #include <MicroNetwork/Host/NodeContext.h>
+#include <MicroNetwork/Host/RxTimestamp.h>
+#include <MicroNetwork/Host/PacketDispatch.h>
+#include <MicroNetwork/Host/LinkProvider.h>
 
 namespace MicroNetwork::Host {
 
@@ -25,9 +28,18 @@ public:
     virtual void removeNode(std::shared_ptr<NodeContext> node) = 0;
 };
 
+//Result of non-blocking packet write, Closed is final while Full clears once the link drains TX buffer
+enum class WriteStatus {
+    Ok,
+    Full,
+    Closed
+};
+
 class Host : public Common::DataStream {
 public:
     Host(std::string path, std::shared_ptr<DataStream> remoteStream, INodeContainer* nodeContainer) : _remoteStream(remoteStream), _path(path), _nodeContainer(nodeContainer) {
+        _rxTimestampSource = dynamic_cast<IRxTimestampSource*>(remoteStream.get());
+        _linkStatsSource = dynamic_cast<ILinkStatsSource*>(remoteStream.get());
         remoteStream->bind(this);
         bind(remoteStream.get());
     }
@@ -37,7 +49,14 @@ public:
     }
 
     ~Host(){
+        //Writers blocked on TX space, and those arriving until nodes are detached, fail instead of waiting
+        _closed = true;
+        _txAvailable.give();
         notifyDisconnect();
+        //Wake TX waiters, host is closed so retries fail instead of waiting forever
+        onReadBytes();
+        //Join link threads first: RX thread must not parse packets into nodes being detached
+        _remoteStream.reset();
         clearNodes();
     }
 
@@ -45,20 +64,53 @@ public:
         return _state;
     }
 
+    //Returns false once host is closed for destruction
     bool blockingWritePacket(Common::PacketHeader header, const void* data) {
         while(true){
             _txAvailable.take();
-            LFramework::Threading::CriticalSection lock;
-            if(freeSpace() >= packetFullSize(header)){
-                write(&header, sizeof(header));
-                if(data != nullptr){
-                    write(data, header.size);
-                }
-                return true;
+            if(_closed){
+                //Pass wakeup on to other blocked writers
+                _txAvailable.give();
+                return false;
+            }
+            auto status = tryWritePacket(header, data);
+            if(status != WriteStatus::Full){
+                return status == WriteStatus::Ok;
             }
         }
     }
 
+    WriteStatus tryWritePacket(Common::PacketHeader header, const void* data) {
+        LFramework::Threading::CriticalSection lock;
+        if(_closed){
+            return WriteStatus::Closed;
+        }
+        if(freeSpace() < packetFullSize(header)){
+            return WriteStatus::Full;
+        }
+        write(&header, sizeof(header));
+        if(data != nullptr){
+            write(data, header.size);
+        }
+        return WriteStatus::Ok;
+    }
+
+    //Incremented every time the link consumes bytes from TX buffer
+    std::uint32_t getTxEpoch() const {
+        return _txEpoch;
+    }
+
+    //Callback is invoked once on link thread when TX space is released after 'epoch'.
+    //Returns false (callback dropped) if space was already released, caller should retry write
+    bool subscribeTxAvailable(std::uint32_t epoch, std::function<void()> callback) {
+        std::lock_guard<std::mutex> lock(_txWaitersMutex);
+        if(_closed || (_txEpoch != epoch)){
+            return false;
+        }
+        _txWaiters.push_back(std::move(callback));
+        return true;
+    }
+
     bool isConnected() {
         return _connected;
     }
@@ -66,6 +118,15 @@ public:
     const std::string& getPath() const {
         return _path;
     }
+
+    LinkStats getLinkStats() const {
+        LinkStats result;
+        if(_linkStatsSource != nullptr){
+            result = _linkStatsSource->getLinkStats();
+        }
+        result.path = _path;
+        return result;
+    }
 protected:
     std::shared_ptr<DataStream> _remoteStream;
     std::string _path;
@@ -99,6 +160,7 @@ protected:
     void clearNodes() {
         for(auto node : _nodes){
             _nodeContainer->removeNode(node.second);
+            node.second->onLinkDisconnect();
         }
         _nodes.clear();
     }
@@ -131,6 +193,7 @@ protected:
         Common::MaxPacket packet;
 
         while(readPacket(packet)){
+            auto rxTimestamp = (_rxTimestampSource != nullptr) ? _rxTimestampSource->getLastRxTimestamp() : RxClock::now();
             //lfDebug() << "Host received packet: id=" << packet.header.id << " size=" << packet.header.size;
 
             if(packet.header.id == Common::PacketId::Bind){
@@ -138,9 +201,12 @@ protected:
 
                 lfDebug() << "Bind response received";
 
-                lfAssert(packet.header.size == 4);
-                std::uint32_t tasksCount;
-                memcpy(&tasksCount, packet.payload.data(), sizeof(tasksCount));
+                auto bind = PacketView<std::uint32_t>::parse(packet.header, packet.payload.data());
+                if(!bind.has_value()){
+                    lfDebug() << "Drop malformed bind packet, size=" << packet.header.size;
+                    continue;
+                }
+                auto tasksCount = **bind;
 
                 auto nodeId = 0;
                 auto nodeContext = std::make_shared<NodeContext>(nodeId, tasksCount, this);
@@ -153,13 +219,15 @@ protected:
                 auto node = getNode(nodeId);
                 if(node != nullptr){
                     if(packet.header.id == Common::PacketId::TaskDescription){
-                        lfAssert(packet.header.size == sizeof(LFramework::Guid));
-                        LFramework::Guid taskId;
-                        memcpy(&taskId, packet.payload.data(), sizeof(taskId));
-                        node->addTask(taskId);
+                        auto taskDescription = PacketView<LFramework::Guid>::parse(packet.header, packet.payload.data());
+                        if(!taskDescription.has_value()){
+                            lfDebug() << "Drop malformed task description, size=" << packet.header.size;
+                            continue;
+                        }
+                        node->addTask(**taskDescription);
                         lfDebug() << "Received task ID";
                     }else{
-                        node->handleNetworkPacket(packet.header, packet.payload.data());
+                        node->handleNetworkPacket(packet.header, packet.payload.data(), rxTimestamp);
                     }
                 }else{
                     lfDebug() << "Drop packet";
@@ -172,12 +240,28 @@ protected:
 
     void onReadBytes() override {
         _txAvailable.give();
+
+        std::vector<std::function<void()>> waiters;
+        {
+            std::lock_guard<std::mutex> lock(_txWaitersMutex);
+            ++_txEpoch;
+            waiters.swap(_txWaiters);
+        }
+        for(auto& waiter : waiters){
+            waiter();
+        }
     }
 
 private:
     bool _connected = true;
+    std::atomic<bool> _closed = false;
     INodeContainer* _nodeContainer = nullptr;
+    IRxTimestampSource* _rxTimestampSource = nullptr;
+    ILinkStatsSource* _linkStatsSource = nullptr;
     LFramework::Threading::BinarySemaphore _txAvailable;
+    std::mutex _txWaitersMutex;
+    std::atomic<std::uint32_t> _txEpoch = 0;
+    std::vector<std::function<void()>> _txWaiters;
 };
 
 }
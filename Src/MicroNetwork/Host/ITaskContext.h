@@ -12,13 +12,14 @@ struct InterfaceAbi<MicroNetwork::Host::ITaskContext> : public InterfaceAbi<IUnk
     using Base = InterfaceAbi<IUnknown>;
     static constexpr InterfaceID ID() { return { 0xb5d3122a, 0x42034b98, 0xa780aca8, 0xeaaf5d58 }; }
     virtual Result setUserDataReceiver(LFramework::ComPtr<MicroNetwork::Common::IDataReceiver> userDataReceiver) = 0;
-    virtual Result handleNetworkPacket(MicroNetwork::Common::PacketHeader header, const void* data) = 0;
+    //rxTimestamp is RxClock ticks of link receive time
+    virtual Result handleNetworkPacket(MicroNetwork::Common::PacketHeader header, const void* data, std::int64_t rxTimestamp) = 0;
 };
 
 template<class TImplementer>
 struct InterfaceRemap<MicroNetwork::Host::ITaskContext, TImplementer> : public InterfaceRemap<IUnknown, TImplementer> {
 public:
     virtual Result setUserDataReceiver(LFramework::ComPtr<MicroNetwork::Common::IDataReceiver> userDataReceiver) { return this->implementer()->setUserDataReceiver(userDataReceiver); }
-    virtual Result handleNetworkPacket(MicroNetwork::Common::PacketHeader header, const void* data) { return this->implementer()->handleNetworkPacket(header, data); }
+    virtual Result handleNetworkPacket(MicroNetwork::Common::PacketHeader header, const void* data, std::int64_t rxTimestamp) { return this->implementer()->handleNetworkPacket(header, data, rxTimestamp); }
 };
 }
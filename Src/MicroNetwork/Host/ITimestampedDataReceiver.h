@@ -0,0 +1,28 @@
+#pragma once
+
+#include <MicroNetwork.Common.h>
+#include <MicroNetwork/Host/RxTimestamp.h>
+
+namespace MicroNetwork::Host {
+    //User data receiver that also takes link receive time of each packet. Looked up on the receiver
+    //passed to task start, receivers without it get plain IDataReceiver::packet
+    class ITimestampedDataReceiver;
+}
+
+namespace LFramework {
+template<>
+struct InterfaceAbi<MicroNetwork::Host::ITimestampedDataReceiver> : public InterfaceAbi<MicroNetwork::Common::IDataReceiver> {
+    using Base = InterfaceAbi<MicroNetwork::Common::IDataReceiver>;
+    static constexpr InterfaceID ID() { return { 0x1b423b6d, 0x134c4ca7, 0x91878e05, 0x00e301c5 }; }
+    //rxTimestamp is RxClock ticks
+    virtual Result timestampedPacket(MicroNetwork::Common::PacketHeader header, const void* data, std::int64_t rxTimestamp) = 0;
+};
+
+template<class TImplementer>
+struct InterfaceRemap<MicroNetwork::Host::ITimestampedDataReceiver, TImplementer> : public InterfaceRemap<MicroNetwork::Common::IDataReceiver, TImplementer> {
+public:
+    virtual Result timestampedPacket(MicroNetwork::Common::PacketHeader header, const void* data, std::int64_t rxTimestamp) {
+        return this->implementer()->timestampedPacket(header, data, MicroNetwork::Host::RxClock::time_point(MicroNetwork::Host::RxClock::duration(rxTimestamp)));
+    }
+};
+}
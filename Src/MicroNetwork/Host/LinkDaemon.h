@@ -0,0 +1,391 @@
+#pragma once
+
+#include <MicroNetwork/Host/Network.h>
+#include <MicroNetwork/Host/NodeContext.h>
+#include <MicroNetwork/Host/ShmRing.h>
+#include <MicroNetwork/Host/DaemonProtocol.h>
+#include <MicroNetwork/Host/RxTimestamp.h>
+#include <LFramework/Debug.h>
+#include <atomic>
+#include <condition_variable>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace MicroNetwork::Host {
+
+//Shares nodes of a Network (owned by caller, must outlive daemon) with other processes.
+//Every client process sees each ready node as a link and runs its own Host over it;
+//the daemon emulates device side of the protocol and arbitrates the real node.
+//Nodes still run one task at a time, a TaskStart for a busy node is answered with TaskStop.
+class LinkDaemon {
+public:
+    LinkDaemon(Network& network, std::string socketPath, std::size_t ringCapacity = 1024 * 1024) :
+        _network(network), _socketPath(socketPath), _ringCapacity(ringCapacity) {
+        auto address = DaemonProtocol::makeAddress(socketPath);
+        _listenFd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+        if(_listenFd < 0){
+            throw std::runtime_error("Failed to create daemon socket");
+        }
+        unlink(socketPath.c_str());
+        if((::bind(_listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) || (::listen(_listenFd, 16) != 0)){
+            ::close(_listenFd);
+            throw std::runtime_error("Failed to listen on daemon socket: " + socketPath);
+        }
+        _links = getLinks();
+        _acceptThread = std::thread(&LinkDaemon::acceptThreadHandler, this);
+        _stateThread = std::thread(&LinkDaemon::stateThreadHandler, this);
+        lfDebug() << "Link daemon listening on " << socketPath.c_str();
+    }
+
+    ~LinkDaemon() {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _running = false;
+            for(auto& connection : _connections){
+                shutdown(connection->fd, SHUT_RDWR);
+            }
+        }
+        _stateCondition.notify_all();
+        shutdown(_listenFd, SHUT_RDWR);
+        _acceptThread.join();
+        _stateThread.join();
+        for(auto& connection : _connections){
+            connection->thread.join();
+        }
+        _connections.clear();
+        ::close(_listenFd);
+        unlink(_socketPath.c_str());
+    }
+private:
+    class NodeProxy {
+    public:
+        NodeProxy(NodeHandle handle, std::shared_ptr<NodeContext> node, std::shared_ptr<ShmRing> input, std::shared_ptr<ShmRing> output) :
+            _handle(handle), _node(node), _input(input), _output(std::make_shared<Output>()) {
+            _output->ring = output;
+            _output->input = input;
+        }
+
+        NodeHandle getHandle() const {
+            return _handle;
+        }
+
+        void close() {
+            _input->close();
+            _output->ring->close();
+        }
+
+        //Handles client packets until rings are closed
+        void run() {
+            Common::MaxPacket packet;
+            while(_input->readAll(&packet.header, sizeof(packet.header))){
+                if(packet.header.size > packet.payload.size()){
+                    lfDebug() << "Link daemon: invalid packet size " << packet.header.size;
+                    break;
+                }
+                if(!_input->readAll(packet.payload.data(), packet.header.size)){
+                    break;
+                }
+                handleClientPacket(packet);
+            }
+            close();
+            _task = nullptr;
+        }
+    private:
+        struct Output {
+            std::mutex mutex;
+            std::shared_ptr<ShmRing> ring;
+            std::shared_ptr<ShmRing> input;
+            std::atomic<bool> taskStarted = false;
+
+            //Called from real link thread too, so never blocks: the link and its node are shared
+            //with other clients. Client that falls a full ring behind is disconnected
+            bool writePacket(Common::PacketHeader header, const void* data, RxClock::time_point rxTimestamp = RxClock::now()) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if(ring->isClosed()){
+                    return false;
+                }
+                auto dataSize = (data == nullptr) ? 0 : header.size;
+                DaemonProtocol::RxRecordHeader record{ rxTimestamp.time_since_epoch().count() };
+                if(ring->freeSpace() < sizeof(record) + sizeof(header) + dataSize){
+                    lfDebug() << "Link daemon: client ring overflow, closing link";
+                    ring->close();
+                    input->close();
+                    return false;
+                }
+                ring->write(&record, sizeof(record));
+                ring->write(&header, sizeof(header));
+                if(dataSize != 0){
+                    ring->write(data, dataSize);
+                }
+                return true;
+            }
+
+            void writeTaskStop() {
+                Common::PacketHeader header;
+                header.id = Common::PacketId::TaskStop;
+                header.size = 0;
+                writePacket(header, nullptr);
+            }
+        };
+
+        class Receiver : public LFramework::RefCountedObject {
+        public:
+            Receiver(std::shared_ptr<Output> output) : _output(output) {
+
+            }
+            LFramework::Result packet(Common::PacketHeader header, const void* data) {
+                return timestampedPacket(header, data, RxClock::now());
+            }
+            LFramework::Result timestampedPacket(Common::PacketHeader header, const void* data, RxClock::time_point rxTimestamp) {
+                return _output->writePacket(header, data, rxTimestamp) ? LFramework::Result::Ok : LFramework::Result::UnknownFailure;
+            }
+            void onRelease() {
+                if(_output->taskStarted.exchange(false)){
+                    _output->writeTaskStop();
+                }
+            }
+        private:
+            std::shared_ptr<Output> _output;
+        };
+
+        void handleClientPacket(const Common::MaxPacket& packet) {
+            if(packet.header.id == Common::PacketId::Bind){
+                auto tasks = _node->getTasks();
+                Common::MaxPacket response;
+                response.header.id = Common::PacketId::Bind;
+                response.setData(static_cast<std::uint32_t>(tasks.size()));
+                _output->writePacket(response.header, response.payload.data());
+                for(auto& task : tasks){
+                    response.header.id = Common::PacketId::TaskDescription;
+                    response.setData(task);
+                    _output->writePacket(response.header, response.payload.data());
+                }
+            }else if(packet.header.id == Common::PacketId::TaskStart){
+                if((_task != nullptr) || (packet.header.size != sizeof(LFramework::Guid))){
+                    //Client Host never starts second task
+                    return;
+                }
+                LFramework::Guid taskId;
+                memcpy(&taskId, packet.payload.data(), sizeof(taskId));
+                _output->taskStarted = true;
+                auto obj = new Receiver(_output);
+                auto receiver = LFramework::makeComDelegate<ITimestampedDataReceiver>(obj, &Receiver::onRelease);
+                _task = _node->startTask(taskId, receiver.queryInterface<Common::IDataReceiver>());
+                if(_task != nullptr){
+                    _output->writePacket(packet.header, packet.payload.data());
+                }else if(_output->taskStarted.exchange(false)){
+                    //Rejected start: released receiver may already have answered with TaskStop,
+                    //whoever clears taskStarted sends the only one
+                    _output->writeTaskStop();
+                }
+            }else if(packet.header.id == Common::PacketId::TaskStop){
+                if(_task != nullptr){
+                    //Node requests stop, TaskStop is forwarded to client when real task is released
+                    _task = nullptr;
+                }else{
+                    _output->writeTaskStop();
+                }
+            }else if(_task != nullptr){
+                _task->packet(packet.header, packet.payload.data());
+            }
+        }
+
+        NodeHandle _handle;
+        std::shared_ptr<NodeContext> _node;
+        std::shared_ptr<ShmRing> _input;
+        std::shared_ptr<Output> _output;
+        LFramework::ComPtr<Common::IDataReceiver> _task;
+    };
+
+    struct Connection {
+        //fd is closed with the last reference, so it is not reused while someone still sends to it
+        ~Connection() {
+            if(fd >= 0){
+                ::close(fd);
+            }
+        }
+        int fd = -1;
+        std::thread thread;
+        std::atomic<bool> finished = false;
+        bool subscribed = false;
+    };
+
+    std::vector<std::string> getLinks() {
+        std::vector<std::string> result;
+        for(auto node : _network.getNodes()){
+            auto state = _network.getNodeState(node);
+            if((state != NodeState::NotReady) && (state != NodeState::InvalidNode)){
+                result.push_back("node:" + std::to_string(node.value));
+            }
+        }
+        return result;
+    }
+
+    std::shared_ptr<NodeContext> findNode(const std::string& link, NodeHandle& handle) {
+        const std::string prefix = "node:";
+        if(link.compare(0, prefix.size(), prefix) != 0){
+            return nullptr;
+        }
+        try {
+            handle = NodeHandle{ static_cast<std::uint32_t>(std::stoul(link.substr(prefix.size()))) };
+        } catch (const std::exception&) {
+            return nullptr;
+        }
+        return _network.findNode(handle);
+    }
+
+    void acceptThreadHandler() {
+        while(true){
+            auto fd = accept4(_listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+            std::lock_guard<std::mutex> lock(_mutex);
+            if(!_running){
+                if(fd >= 0){
+                    ::close(fd);
+                }
+                return;
+            }
+            if(fd < 0){
+                continue;
+            }
+
+            //Reap finished connections
+            auto it = _connections.begin();
+            while(it != _connections.end()){
+                if((*it)->finished){
+                    (*it)->thread.join();
+                    it = _connections.erase(it);
+                }else{
+                    ++it;
+                }
+            }
+
+            auto connection = std::make_shared<Connection>();
+            connection->fd = fd;
+            connection->thread = std::thread(&LinkDaemon::connectionHandler, this, connection.get());
+            _connections.push_back(connection);
+        }
+    }
+
+    void connectionHandler(Connection* connection) {
+        auto request = DaemonProtocol::receiveMessage(connection->fd);
+        if(request.has_value()){
+            if(request->id == DaemonProtocol::MessageId::GetLinks){
+                std::vector<std::string> links;
+                {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    links = _links;
+                }
+                DaemonProtocol::sendMessage(connection->fd, { DaemonProtocol::MessageId::Links, links });
+            }else if(request->id == DaemonProtocol::MessageId::Subscribe){
+                {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    connection->subscribed = true;
+                }
+                waitDisconnect(connection->fd);
+            }else if((request->id == DaemonProtocol::MessageId::OpenLink) && !request->values.empty()){
+                serveLink(connection->fd, request->values[0]);
+            }
+        }
+        std::lock_guard<std::mutex> lock(_mutex);
+        connection->subscribed = false;
+        connection->finished = true;
+    }
+
+    void serveLink(int fd, const std::string& link) {
+        NodeHandle handle;
+        auto node = findNode(link, handle);
+        if(node == nullptr){
+            DaemonProtocol::sendMessage(fd, { DaemonProtocol::MessageId::LinkFailed, { "Unknown link" } });
+            return;
+        }
+
+        std::shared_ptr<NodeProxy> proxy;
+        try {
+            auto ringPrefix = "/mnh-" + std::to_string(getpid()) + "-" + std::to_string(_ringCounter++);
+            auto input = ShmRing::create(ringPrefix + "-c2d", _ringCapacity);
+            auto output = ShmRing::create(ringPrefix + "-d2c", _ringCapacity);
+            proxy = std::make_shared<NodeProxy>(handle, node, input, output);
+            DaemonProtocol::sendMessage(fd, { DaemonProtocol::MessageId::LinkOpened, { input->getName(), output->getName() } });
+        } catch (const std::exception& ex) {
+            DaemonProtocol::sendMessage(fd, { DaemonProtocol::MessageId::LinkFailed, { ex.what() } });
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _proxies.push_back(proxy);
+        }
+        std::thread proxyThread(&NodeProxy::run, proxy);
+        waitDisconnect(fd);
+        proxy->close();
+        proxyThread.join();
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        _proxies.remove(proxy);
+    }
+
+    void waitDisconnect(int fd) {
+        while(DaemonProtocol::receiveMessage(fd).has_value()){
+
+        }
+    }
+
+    void stateThreadHandler() {
+        std::unique_lock<std::mutex> lock(_mutex);
+        while(_running){
+            _stateCondition.wait_for(lock, std::chrono::milliseconds(50));
+            if(!_running){
+                return;
+            }
+            lock.unlock();
+            auto links = getLinks();
+            lock.lock();
+            if(links == _links){
+                continue;
+            }
+            _links = links;
+
+            for(auto& proxy : _proxies){
+                if(_network.findNode(proxy->getHandle()) == nullptr){
+                    proxy->close();
+                }
+            }
+            std::vector<std::shared_ptr<Connection>> subscribers;
+            for(auto& connection : _connections){
+                if(connection->subscribed){
+                    subscribers.push_back(connection);
+                }
+            }
+
+            //Subscriber that stops reading must not block daemon. If its socket is full it has
+            //unread LinksChanged already, so dropping this one loses nothing
+            lock.unlock();
+            for(auto& subscriber : subscribers){
+                DaemonProtocol::sendMessage(subscriber->fd, { DaemonProtocol::MessageId::LinksChanged, {} }, MSG_DONTWAIT);
+            }
+            subscribers.clear();
+            lock.lock();
+        }
+    }
+
+    Network& _network;
+    std::string _socketPath;
+    std::size_t _ringCapacity;
+    int _listenFd = -1;
+    std::atomic<std::uint32_t> _ringCounter = 0;
+
+    std::mutex _mutex;
+    std::condition_variable _stateCondition;
+    bool _running = true;
+    std::vector<std::string> _links;
+    std::list<std::shared_ptr<Connection>> _connections;
+    std::list<std::shared_ptr<NodeProxy>> _proxies;
+    std::thread _acceptThread;
+    std::thread _stateThread;
+};
+
+}
@@ -5,9 +5,37 @@
 #include <vector>
 #include <mutex>
 #include <memory>
+#include <cstdint>
+#include <functional>
 
 namespace MicroNetwork::Host {
 
+struct LinkConfig {
+    //Host-side RX buffer between bus completions and packet parsing, 0 disables it
+    std::size_t rxRingSize = 0;
+    bool hugePages = false;
+};
+
+//Chooses configuration of each link by its path when the link is opened,
+//e.g. large rings for high-rate boards only. Empty resolver means default LinkConfig
+using LinkConfigResolver = std::function<LinkConfig(const std::string& linkPath)>;
+
+struct LinkStats {
+    std::string path;
+    std::size_t rxRingCapacity = 0;
+    std::size_t rxRingHighWaterMark = 0;
+    bool rxRingHugePages = false;
+    //Times bus reads were held back because host-side buffers were full
+    std::uint64_t rxStalls = 0;
+};
+
+//Implemented by link streams that can report buffer statistics
+class ILinkStatsSource {
+public:
+    virtual ~ILinkStatsSource() = default;
+    virtual LinkStats getLinkStats() const = 0;
+};
+
 class ILinkCallback {
 public:
     virtual ~ILinkCallback() = default;
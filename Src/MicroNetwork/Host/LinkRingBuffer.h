@@ -0,0 +1,108 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <memory>
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+namespace MicroNetwork::Host {
+
+//Single producer single consumer byte ring used as host-side link buffer.
+//Large rings may be backed by huge pages, falls back to regular memory when unavailable
+class LinkRingBuffer {
+public:
+    LinkRingBuffer(std::size_t capacity, bool hugePages) : _capacity(capacity) {
+#ifdef __linux__
+        if(hugePages){
+            constexpr std::size_t HugePageSize = 2 * 1024 * 1024;
+            auto mappingSize = (capacity + HugePageSize - 1) / HugePageSize * HugePageSize;
+            auto mapping = mmap(nullptr, mappingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if(mapping != MAP_FAILED){
+                _data = static_cast<std::uint8_t*>(mapping);
+                _mappingSize = mappingSize;
+            }
+        }
+#else
+        (void)hugePages;
+#endif
+        if(_data == nullptr){
+            _heapData = std::make_unique<std::uint8_t[]>(capacity);
+            _data = _heapData.get();
+        }
+    }
+
+    ~LinkRingBuffer() {
+#ifdef __linux__
+        if(_mappingSize != 0){
+            munmap(_data, _mappingSize);
+        }
+#endif
+    }
+
+    LinkRingBuffer(const LinkRingBuffer&) = delete;
+    LinkRingBuffer& operator=(const LinkRingBuffer&) = delete;
+
+    std::size_t getCapacity() const {
+        return _capacity;
+    }
+
+    bool isHugePageBacked() const {
+        return _mappingSize != 0;
+    }
+
+    std::size_t bytesAvailable() const {
+        return static_cast<std::size_t>(_head.load() - _tail.load());
+    }
+
+    std::size_t getHighWaterMark() const {
+        return _highWaterMark.load();
+    }
+
+    //Producer side, returns bytes written
+    std::size_t write(const void* data, std::size_t size) {
+        auto head = _head.load(std::memory_order_relaxed);
+        auto tail = _tail.load(std::memory_order_acquire);
+        size = std::min<std::size_t>(size, _capacity - static_cast<std::size_t>(head - tail));
+        if(size == 0){
+            return 0;
+        }
+        auto offset = static_cast<std::size_t>(head % _capacity);
+        auto firstPart = std::min(size, _capacity - offset);
+        memcpy(_data + offset, data, firstPart);
+        memcpy(_data, static_cast<const std::uint8_t*>(data) + firstPart, size - firstPart);
+        _head.store(head + size, std::memory_order_release);
+
+        auto used = static_cast<std::size_t>(head + size - tail);
+        if(used > _highWaterMark.load(std::memory_order_relaxed)){
+            _highWaterMark.store(used, std::memory_order_relaxed);
+        }
+        return size;
+    }
+
+    //Consumer side: contiguous readable region, release it with consume()
+    const std::uint8_t* readRegion(std::size_t& size) const {
+        auto tail = _tail.load(std::memory_order_relaxed);
+        auto head = _head.load(std::memory_order_acquire);
+        auto offset = static_cast<std::size_t>(tail % _capacity);
+        size = std::min(static_cast<std::size_t>(head - tail), _capacity - offset);
+        return _data + offset;
+    }
+
+    void consume(std::size_t size) {
+        _tail.store(_tail.load(std::memory_order_relaxed) + size, std::memory_order_release);
+    }
+private:
+    std::size_t _capacity;
+    std::uint8_t* _data = nullptr;
+    std::size_t _mappingSize = 0;
+    std::unique_ptr<std::uint8_t[]> _heapData;
+    std::atomic<std::uint64_t> _head = 0;
+    std::atomic<std::uint64_t> _tail = 0;
+    std::atomic<std::size_t> _highWaterMark = 0;
+};
+
+}
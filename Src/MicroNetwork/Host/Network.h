@@ -9,6 +9,13 @@
 #include <unordered_map>
 #include <MicroNetwork/Host/Host.h>
 #include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <thread>
+#include <unordered_set>
+#include <optional>
+#include <cstring>
 
 
 namespace std {
@@ -27,30 +34,83 @@ namespace MicroNetwork::Host {
         return l.value == r.value;
     }
 
+struct GuidHash {
+    size_t operator()(const LFramework::Guid& x) const {
+        std::uint8_t bytes[sizeof(LFramework::Guid)];
+        memcpy(bytes, &x, sizeof(bytes));
+        //FNV-1a
+        std::uint64_t result = 14695981039346656037ull;
+        for(auto b : bytes){
+            result = (result ^ b) * 1099511628211ull;
+        }
+        return static_cast<size_t>(result);
+    }
+};
+
 
 class LinkProviderContext : public ILinkCallback{
 public:
     LinkProviderContext(std::function<std::shared_ptr<LinkProvider>(ILinkCallback*)> providerConstructor, INodeContainer* nodeContainer) :_nodeContainer(nodeContainer){
+        _teardownThread = std::thread(&LinkProviderContext::teardownThreadHandler, this);
+        //Provider may report changes from its own thread before construction completes
+        std::lock_guard<std::recursive_mutex> lock(_linksMutex);
         _provider = providerConstructor(this);
 
         linksChanged();
     }
+    ~LinkProviderContext(){
+        std::shared_ptr<LinkProvider> provider;
+        {
+            std::lock_guard<std::recursive_mutex> lock(_linksMutex);
+            provider = std::move(_provider);
+        }
+        provider.reset();
+        {
+            std::lock_guard<std::mutex> lock(_teardownMutex);
+            for(auto& host : _hosts){
+                _teardownQueue.push_back(host);
+            }
+            _teardownRunning = false;
+        }
+        _hosts.clear();
+        _teardownCondition.notify_one();
+        _teardownThread.join();
+    }
+    std::vector<LinkStats> getLinkStats() {
+        std::lock_guard<std::recursive_mutex> lock(_linksMutex);
+        std::vector<LinkStats> result;
+        for(auto& host : _hosts){
+            result.push_back(host->getLinkStats());
+        }
+        return result;
+    }
     void linksChanged() override {
+        std::lock_guard<std::recursive_mutex> lock(_linksMutex);
+        if(_provider == nullptr){
+            return;
+        }
         auto newLinks = _provider->getLinks();
 
-        //remove deleted links
+        //remove deleted links, destruction (transfer cancel and thread join) happens on teardown thread
         auto it = _hosts.begin();
         while (it != _hosts.end()) {
             if(!(*it)->isConnected() || std::find(newLinks.begin(), newLinks.end(), (*it)->getPath()) == newLinks.end()){
+                {
+                    std::lock_guard<std::mutex> lock(_teardownMutex);
+                    _teardownQueue.push_back(*it);
+                    _tearingDown.insert((*it)->getPath());
+                }
+                _teardownCondition.notify_one();
                 it = _hosts.erase(it);
             } else {
                 ++it;
             }
         }
 
-        //add new links
+        //add new links. Link whose old host is still being torn down keeps device open,
+        //it is reopened when teardown completes
         for(const auto& link : newLinks){
-            if(!hasHost(link)){
+            if(!hasHost(link) && !isTearingDown(link)){
                 try{
                     auto stream = _provider->makeStream(link);
                     auto host = std::make_shared<Host>(link, stream, _nodeContainer);
@@ -64,6 +124,35 @@ public:
         }
     }
 private:
+    void teardownThreadHandler() {
+        std::unique_lock<std::mutex> lock(_teardownMutex);
+        while(true){
+            _teardownCondition.wait(lock, [this]{ return !_teardownRunning || !_teardownQueue.empty(); });
+            if(_teardownQueue.empty()){
+                return;
+            }
+            auto host = _teardownQueue.front();
+            _teardownQueue.pop_front();
+            lock.unlock();
+            auto path = host->getPath();
+            lfDebug() << "Host teardown for path: " << path.c_str();
+            host = nullptr;
+            lock.lock();
+            _tearingDown.erase(path);
+            if(_teardownRunning){
+                lock.unlock();
+                //Device may still be listed, open it again now that old host released it
+                linksChanged();
+                lock.lock();
+            }
+        }
+    }
+
+    bool isTearingDown(const std::string& path) {
+        std::lock_guard<std::mutex> lock(_teardownMutex);
+        return _tearingDown.find(path) != _tearingDown.end();
+    }
+
     bool hasHost(const std::string& path){
         for(auto h : _hosts){
             if(h->getPath() == path){
@@ -72,19 +161,35 @@ private:
         }
         return false;
     }
+    std::recursive_mutex _linksMutex;
     std::vector<std::shared_ptr<Host>> _hosts;
     std::shared_ptr<LinkProvider> _provider;
     INodeContainer* _nodeContainer;
+    std::mutex _teardownMutex;
+    std::condition_variable _teardownCondition;
+    std::deque<std::shared_ptr<Host>> _teardownQueue;
+    std::unordered_set<std::string> _tearingDown;
+    bool _teardownRunning = true;
+    std::thread _teardownThread;
+};
+
+struct TaskStartResult {
+    NodeHandle node;
+    LFramework::ComPtr<MicroNetwork::Common::IDataReceiver> task;
 };
 
-class Network : public LFramework::ComImplement<Network, LFramework::ComObject, INetwork>, public INodeContainer {
+class Network : public LFramework::ComImplement<Network, LFramework::ComObject, INetwork>, public INodeContainer, public INodeStateListener {
 public:
-    Network(std::uint16_t vid, std::uint16_t pid){
+    //linkConfigResolver is asked for configuration of each link as it is opened, see LinkConfig
+    Network(std::uint16_t vid, std::uint16_t pid, LinkConfigResolver linkConfigResolver = {}){
         _linkProviders.push_back(std::make_shared<LinkProviderContext>(
-                                     [=](ILinkCallback* callback){ return std::make_shared<UsbLinkProvider>(vid, pid, callback); },
+                                     [=](ILinkCallback* callback){ return std::make_shared<UsbLinkProvider>(vid, pid, callback, linkConfigResolver); },
                                      this)
                                  );
     }
+    Network(std::function<std::shared_ptr<LinkProvider>(ILinkCallback*)> providerConstructor){
+        _linkProviders.push_back(std::make_shared<LinkProviderContext>(providerConstructor, this));
+    }
     LFramework::ComPtr<MicroNetwork::Common::IDataReceiver> startTask(NodeHandle nodeHandle, LFramework::Guid taskId, LFramework::ComPtr<MicroNetwork::Common::IDataReceiver> userDataReceiver){
         std::unique_lock<std::mutex> lock(_nodesMutex);
         auto node = getNode(nodeHandle);
@@ -93,6 +198,200 @@ public:
         return node->startTask(taskId, userDataReceiver);
     }
 
+    //Sends all TaskStart packets up front and waits for acknowledgements concurrently.
+    //userDataReceivers[i] is bound to nodes[i]; failed nodes get nullptr task. All nodes fail if sizes differ.
+    //Nodes whose link TX buffer is full are retried after the others are issued. Nodes not started
+    //within timeout are reported as failed, a start acknowledged later is stopped right away
+    std::vector<TaskStartResult> startTask(const std::vector<NodeHandle>& nodes, LFramework::Guid taskId,
+                                                const std::vector<LFramework::ComPtr<MicroNetwork::Common::IDataReceiver>>& userDataReceivers,
+                                                std::chrono::milliseconds timeout = std::chrono::seconds(5)){
+        if(nodes.size() != userDataReceivers.size()){
+            //Receivers can't be paired with nodes, report every node as failed without starting anything
+            lfDebug() << "Group task start rejected: nodes and receivers count differ";
+            std::vector<TaskStartResult> failed;
+            for(auto nodeHandle : nodes){
+                failed.push_back(TaskStartResult{ nodeHandle, nullptr });
+            }
+            return failed;
+        }
+
+        struct GroupState {
+            std::mutex mutex;
+            std::condition_variable changed;
+            std::size_t pending = 0;
+            std::uint32_t txWakeups = 0;
+            bool finished = false;
+            std::vector<TaskStartResult> results;
+        };
+        auto state = std::make_shared<GroupState>();
+        for(auto nodeHandle : nodes){
+            state->results.push_back(TaskStartResult{ nodeHandle, nullptr });
+        }
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+
+        //Returns false if node's link is full, caller retries after TX wakeup
+        auto tryStart = [&](std::size_t i, const std::shared_ptr<NodeContext>& node){
+            auto completion = [state, i](LFramework::ComPtr<MicroNetwork::Common::IDataReceiver> task, TaskContext*){
+                std::unique_lock<std::mutex> lock(state->mutex);
+                --state->pending;
+                if(!state->finished){
+                    state->results[i].task = task;
+                    state->changed.notify_all();
+                    return;
+                }
+                lock.unlock();
+                //Caller has given up on this node, releasing task stops it
+                task = nullptr;
+            };
+            {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                ++state->pending;
+            }
+            auto epoch = node->getTxEpoch();
+            auto status = node->startTaskAsync(taskId, userDataReceivers[i], completion);
+            if(status == TaskStartStatus::Pending){
+                return true;
+            }
+            {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                --state->pending;
+            }
+            if(status == TaskStartStatus::Rejected){
+                return true;
+            }
+            auto wakeup = [state](){
+                std::lock_guard<std::mutex> lock(state->mutex);
+                ++state->txWakeups;
+                state->changed.notify_all();
+            };
+            if(!node->subscribeTxAvailable(epoch, wakeup)){
+                wakeup();
+            }
+            return false;
+        };
+
+        std::uint32_t seenWakeups = 0;
+        std::vector<std::pair<std::size_t, std::shared_ptr<NodeContext>>> deferred;
+        for(std::size_t i = 0; i < nodes.size(); ++i){
+            auto node = findNode(nodes[i]);
+            if((node != nullptr) && !tryStart(i, node)){
+                deferred.emplace_back(i, node);
+            }
+        }
+
+        std::unique_lock<std::mutex> lock(state->mutex);
+        while(!deferred.empty()){
+            //Wakeups counted since previous round started, so none is lost while starts are issued
+            if(!state->changed.wait_until(lock, deadline, [&]{ return state->txWakeups != seenWakeups; })){
+                break;
+            }
+            seenWakeups = state->txWakeups;
+            lock.unlock();
+            std::vector<std::pair<std::size_t, std::shared_ptr<NodeContext>>> stillBlocked;
+            for(auto& item : deferred){
+                if(!tryStart(item.first, item.second)){
+                    stillBlocked.push_back(item);
+                }
+            }
+            deferred.swap(stillBlocked);
+            lock.lock();
+        }
+        state->changed.wait_until(lock, deadline, [&state]{ return state->pending == 0; });
+        state->finished = true;
+        return state->results;
+    }
+
+    //Claims an idle node supporting the task and starts it there. If the start fails the next idle node
+    //is tried, each node at most once. std::nullopt if no idle node could start the task
+    std::optional<TaskStartResult> startTaskOnAnyNode(LFramework::Guid taskId, LFramework::ComPtr<MicroNetwork::Common::IDataReceiver> userDataReceiver){
+        std::unordered_set<NodeContext*> tried;
+        while(true){
+            NodeContext* claimed = nullptr;
+            TaskStartResult result{ NodeHandle{}, nullptr };
+            {
+                std::lock_guard<std::mutex> lock(_schedulerMutex);
+                auto idleIt = _idleNodes.find(taskId);
+                if(idleIt == _idleNodes.end()){
+                    return std::nullopt;
+                }
+                for(auto node : idleIt->second){
+                    if(tried.find(node) == tried.end()){
+                        claimed = node;
+                        break;
+                    }
+                }
+                if(claimed == nullptr){
+                    return std::nullopt;
+                }
+                auto& record = _schedulerRecords[claimed];
+                record.claimed = true;
+                updateIdleIndex(claimed, record);
+                result.node = record.handle;
+            }
+            tried.insert(claimed);
+
+            auto node = findNode(result.node);
+            if(node != nullptr){
+                result.task = node->startTask(taskId, userDataReceiver);
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(_schedulerMutex);
+                auto recordIt = _schedulerRecords.find(claimed);
+                if(recordIt != _schedulerRecords.end()){
+                    recordIt->second.claimed = false;
+                    updateIdleIndex(claimed, recordIt->second);
+                }
+            }
+            if(result.task != nullptr){
+                return result;
+            }
+        }
+    }
+
+    std::size_t getIdleNodesCount(LFramework::Guid taskId){
+        std::lock_guard<std::mutex> lock(_schedulerMutex);
+        auto idleIt = _idleNodes.find(taskId);
+        return idleIt == _idleNodes.end() ? 0 : idleIt->second.size();
+    }
+
+    //Token bucket TX shaping for every node running the task. std::nullopt removes the limit.
+    //Returns false (limit not changed) if rate or burst is zero
+    bool setTaskRateLimit(LFramework::Guid taskId, std::optional<RateLimit> limit){
+        if(limit.has_value() && ((limit->bytesPerSecond == 0) || (limit->burstBytes == 0))){
+            lfDebug() << "Rate limit rejected: rate and burst must be nonzero";
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(_nodesMutex);
+        if(limit.has_value()){
+            _rateLimits[taskId] = limit.value();
+        }else{
+            _rateLimits.erase(taskId);
+        }
+        for(auto& nodeRecord : _nodes){
+            nodeRecord.second->setTaskRateLimit(taskId, limit);
+        }
+        return true;
+    }
+
+    std::optional<TokenBucketStats> getTaskShaperStats(NodeHandle nodeHandle, LFramework::Guid taskId){
+        auto node = findNode(nodeHandle);
+        if(node == nullptr){
+            return std::nullopt;
+        }
+        return node->getTaskShaperStats(taskId);
+    }
+
+    //RX buffer usage of every open link, high water marks show whether configured ring sizes absorb bursts
+    std::vector<LinkStats> getLinkStats(){
+        std::vector<LinkStats> result;
+        for(auto& provider : _linkProviders){
+            auto stats = provider->getLinkStats();
+            result.insert(result.end(), stats.begin(), stats.end());
+        }
+        return result;
+    }
+
     bool isTaskSupported(NodeHandle nodeHandle, LFramework::Guid taskId){
         std::lock_guard<std::mutex> lock(_nodesMutex);
         auto node = getNode(nodeHandle);
@@ -135,25 +434,92 @@ public:
         return _stateId.load();
     }
 
+    std::shared_ptr<NodeContext> findNode(NodeHandle nodeHandle) {
+        std::lock_guard<std::mutex> lock(_nodesMutex);
+        return getNode(nodeHandle);
+    }
+
     void addNode(std::shared_ptr<NodeContext> node) override{
         lfDebug() << "Add node";
-        std::lock_guard<std::mutex> lock(_nodesMutex);
-        _nodes[NodeHandle{ _lastNodeId++ }] = node;
-        ++_stateId;
+        NodeHandle handle;
+        {
+            std::lock_guard<std::mutex> lock(_nodesMutex);
+            handle = NodeHandle{ _lastNodeId++ };
+            _nodes[handle] = node;
+            _nodeHandles[node.get()] = handle;
+            for(auto& limit : _rateLimits){
+                node->setTaskRateLimit(limit.first, limit.second);
+            }
+            ++_stateId;
+        }
+        {
+            std::lock_guard<std::mutex> lock(_schedulerMutex);
+            _schedulerRecords[node.get()].handle = handle;
+        }
+        node->setStateListener(this);
     }
     void removeNode(std::shared_ptr<NodeContext> node) override{
         lfDebug() << "Remove node";
-        std::lock_guard<std::mutex> lock(_nodesMutex);
-        for(auto nodeRecord : _nodes){
-            if(nodeRecord.second == node){
-                //nodeRecord.second->onLinkDisconnect();
-                _nodes.erase(nodeRecord.first);
-                break;
+        {
+            std::lock_guard<std::mutex> lock(_nodesMutex);
+            auto handleIt = _nodeHandles.find(node.get());
+            if(handleIt != _nodeHandles.end()){
+                _nodes.erase(handleIt->second);
+                _nodeHandles.erase(handleIt);
             }
+            ++_stateId;
         }
-        ++_stateId;
+        node->setStateListener(nullptr);
+
+        std::lock_guard<std::mutex> lock(_schedulerMutex);
+        auto recordIt = _schedulerRecords.find(node.get());
+        if(recordIt != _schedulerRecords.end()){
+            recordIt->second.idle = false;
+            updateIdleIndex(node.get(), recordIt->second);
+            _schedulerRecords.erase(recordIt);
+        }
+    }
+
+    void nodeStateChanged(NodeContext* node, const std::vector<LFramework::Guid>& tasks, bool idle) override {
+        std::lock_guard<std::mutex> lock(_schedulerMutex);
+        auto recordIt = _schedulerRecords.find(node);
+        if(recordIt == _schedulerRecords.end()){
+            return;
+        }
+        auto& record = recordIt->second;
+        if(record.tasks.size() != tasks.size()){
+            record.idle = false;
+            updateIdleIndex(node, record);
+            record.tasks = tasks;
+        }
+        record.idle = idle;
+        updateIdleIndex(node, record);
     }
 private:
+    struct SchedulerRecord {
+        NodeHandle handle;
+        std::vector<LFramework::Guid> tasks;
+        bool idle = false;
+        bool claimed = false;
+        bool indexed = false;
+    };
+
+    //Must be called with scheduler lock held
+    void updateIdleIndex(NodeContext* node, SchedulerRecord& record) {
+        bool available = record.idle && !record.claimed;
+        if(available == record.indexed){
+            return;
+        }
+        for(auto& task : record.tasks){
+            if(available){
+                _idleNodes[task].insert(node);
+            }else{
+                _idleNodes[task].erase(node);
+            }
+        }
+        record.indexed = available;
+    }
+
     std::shared_ptr<NodeContext> getNode(NodeHandle node) {
         auto it = _nodes.find(node);
         if (it == _nodes.end()) {
@@ -165,6 +531,12 @@ private:
     std::uint32_t _lastNodeId = 0;
     std::atomic<std::uint32_t> _stateId = 0;
     std::unordered_map<NodeHandle, std::shared_ptr<NodeContext>> _nodes;
+    //Reverse of _nodes, removeNode runs for every unplug and must not scan all nodes under _nodesMutex
+    std::unordered_map<NodeContext*, NodeHandle> _nodeHandles;
+    std::unordered_map<LFramework::Guid, RateLimit, GuidHash> _rateLimits;
+    std::mutex _schedulerMutex;
+    std::unordered_map<NodeContext*, SchedulerRecord> _schedulerRecords;
+    std::unordered_map<LFramework::Guid, std::unordered_set<NodeContext*>, GuidHash> _idleNodes;
     std::vector<std::shared_ptr<LinkProviderContext>> _linkProviders;
 };
 
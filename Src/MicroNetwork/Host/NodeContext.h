@@ -7,27 +7,76 @@
 #include <LFramework/Debug.h>
 #include <vector>
 #include <MicroNetwork/Host/TaskContext.h>
+#include <MicroNetwork/Host/TokenBucket.h>
+#include <MicroNetwork/Host/RxTimestamp.h>
 #include <iostream>
+#include <functional>
+#include <atomic>
+#include <optional>
+#include <memory>
+#include <thread>
 
 namespace MicroNetwork::Host {
 
 class Host;
 
+enum class TaskStartStatus {
+    Pending,
+    Rejected,
+    WouldBlock
+};
+
+enum class TxStatus {
+    Ok,
+    WouldBlock,
+    Throttled,
+    Closed
+};
+
 class TaskContextConstructor {
 public:
-    void finalize(bool success){
+    TaskContextConstructor() = default;
+    TaskContextConstructor(std::function<void(bool)> completion) : _completion(std::move(completion)) {
+
+    }
+    //One-shot: TaskStart response and link disconnect may race, only the first result is reported.
+    //Returns false if already finalized or cancelled
+    bool finalize(bool success){
+        if(_finalized.exchange(true)){
+            return false;
+        }
         _success = success;
-        _completionSemaphore.give();
+        if(_completion){
+            _completion(success);
+        }else{
+            _completionSemaphore.give();
+        }
+        return true;
+    }
+    //Finalizes without reporting result, returns false if result was already reported
+    bool cancel() {
+        return !_finalized.exchange(true);
     }
     bool wait() {
         _completionSemaphore.take();
         return _success;
     }
 private:
+    std::atomic<bool> _finalized = false;
     bool _success = false;
+    std::function<void(bool)> _completion;
     LFramework::Threading::BinarySemaphore _completionSemaphore;
 };
 
+class NodeContext;
+
+class INodeStateListener {
+public:
+    virtual ~INodeStateListener() = default;
+    //Called with node task lock held, must not call back into node
+    virtual void nodeStateChanged(NodeContext* node, const std::vector<LFramework::Guid>& tasks, bool idle) = 0;
+};
+
 class NodeContext {
 public:
     NodeContext(std::uint8_t realId, std::uint32_t tasksCount, Host* host) : _realId(realId),  _tasksCount(tasksCount), _host(host){
@@ -36,13 +85,18 @@ public:
     ~NodeContext() {
 
     }
-    void handleNetworkPacket(Common::PacketHeader header, const void* data) {
+    void handleNetworkPacket(Common::PacketHeader header, const void* data, RxClock::time_point rxTimestamp) {
         //lfDebug() << "Node context received packet: id=" << header.id << " size=" << header.size;
 
         if(header.id == Common::PacketId::TaskStop){
             //lfDebug() << "Received TaskStop";
+            std::lock_guard<std::recursive_mutex> lock(_taskMutex);
             if(_currentTask != nullptr){
                 _currentTask.reset();
+                notifyStateChanged();
+            }else if(_nextTask != nullptr){
+                //TaskStop in response to TaskStart means task start rejected
+                _nextTask->finalize(false);
             }
         }else if(header.id == Common::PacketId::TaskStart){
             //lfDebug() << "Received TaskStart";
@@ -53,7 +107,7 @@ public:
         }else{
             std::lock_guard<std::recursive_mutex> lock(_taskMutex);
             if(_currentTask != nullptr){
-                _currentTask->handleNetworkPacket(header, data);
+                _currentTask->handleNetworkPacket(header, data, rxTimestamp.time_since_epoch().count());
             }else{
                 std::cout << "Drop USB packet because task is nullptr" << std::endl;
             }
@@ -61,6 +115,9 @@ public:
         }
     }
     bool handleUserPacket(Common::PacketHeader header, const void* data);
+    TxStatus tryHandleUserPacket(Common::PacketHeader header, const void* data);
+    std::uint32_t getTxEpoch() const;
+    bool subscribeTxAvailable(std::uint32_t epoch, std::function<void()> callback);
     std::uint8_t getRealId() const {
         return _realId;
     }
@@ -68,19 +125,44 @@ public:
 
     LFramework::ComPtr<Common::IDataReceiver> startTask(LFramework::Guid taskId, LFramework::ComPtr<Common::IDataReceiver> userDataReceiver);
 
+    //Non-blocking task start. Completion is called on link thread with task handle (nullptr on failure),
+    //only if Pending is returned. Task context is valid while the handle is held, see TaskContext::tryPacket
+    TaskStartStatus startTaskAsync(LFramework::Guid taskId, LFramework::ComPtr<Common::IDataReceiver> userDataReceiver,
+                                   std::function<void(LFramework::ComPtr<Common::IDataReceiver>, TaskContext*)> completion);
+
+    //Called by Host being destroyed, after it is closed for writes
     void onLinkDisconnect() {
+        _host = nullptr;
+        //Calls that loaded host before it was cleared still use it, Host must outlive them
+        while(_hostUsers != 0){
+            std::this_thread::yield();
+        }
         LFramework::ComPtr<ITaskContext> task;
+        std::shared_ptr<TaskContextConstructor> nextTask;
         {
             std::lock_guard<std::recursive_mutex> lock(_taskMutex);
             task = _currentTask;
             _currentTask = nullptr;
+            nextTask = _nextTask;
+            _nextTask = nullptr;
+            notifyStateChanged();
         }
         task = nullptr;
+        if(nextTask != nullptr){
+            nextTask->finalize(false);
+        }
     }
 
     void addTask(LFramework::Guid taskId) {
         std::lock_guard<std::recursive_mutex> lock(_taskMutex);
         _tasks.push_back(taskId);
+        notifyStateChanged();
+    }
+
+    void setStateListener(INodeStateListener* listener) {
+        std::lock_guard<std::recursive_mutex> lock(_taskMutex);
+        _stateListener = listener;
+        notifyStateChanged();
     }
 
     bool isReady() const {
@@ -91,6 +173,60 @@ public:
         return _currentTask != nullptr;
     }
 
+    //Ready, connected and neither running nor starting a task
+    bool isIdle() const {
+        std::lock_guard<std::recursive_mutex> lock(_taskMutex);
+        return (_host != nullptr) && isReady() && (_currentTask == nullptr) && (_nextTask == nullptr);
+    }
+
+    //TX shaping of task data packets, applied in TaskContext before it takes task lock. std::nullopt removes the limit
+    void setTaskRateLimit(LFramework::Guid taskId, std::optional<RateLimit> limit) {
+        std::lock_guard<std::recursive_mutex> lock(_taskMutex);
+        std::lock_guard<std::mutex> shaperLock(_shaperMutex);
+        bool found = false;
+        for(auto it = _txShapers.begin(); it != _txShapers.end(); ++it){
+            if(it->first == taskId){
+                if(limit.has_value()){
+                    it->second->setLimit(limit.value());
+                }else{
+                    _txShapers.erase(it);
+                }
+                found = true;
+                break;
+            }
+        }
+        if(!found && limit.has_value()){
+            _txShapers.emplace_back(taskId, std::make_shared<TokenBucket>(limit.value()));
+        }
+        if(taskId == _currentTaskId){
+            _currentTaskShaper = findShaper(taskId);
+        }
+    }
+
+    std::optional<TokenBucketStats> getTaskShaperStats(LFramework::Guid taskId) const {
+        std::lock_guard<std::mutex> lock(_shaperMutex);
+        for(auto& shaper : _txShapers){
+            if(shaper.first == taskId){
+                return shaper.second->getStats();
+            }
+        }
+        return std::nullopt;
+    }
+
+    //Delay until packet is allowed by current task shaper
+    std::chrono::microseconds getTxThrottleDelay(Common::PacketHeader header) const {
+        auto shaper = getCurrentTaskShaper();
+        if(shaper == nullptr){
+            return std::chrono::microseconds(0);
+        }
+        return shaper->getDelay(sizeof(header) + header.size);
+    }
+
+    std::vector<LFramework::Guid> getTasks() const {
+        std::lock_guard<std::recursive_mutex> lock(_taskMutex);
+        return _tasks;
+    }
+
     bool isTaskSupported(LFramework::Guid taskId) const {
         std::lock_guard<std::recursive_mutex> lock(_taskMutex);
         for(auto& task : _tasks){
@@ -101,6 +237,12 @@ public:
         return false;
     }
 
+    //Shaper of the task being started or running. Takes only shaper lock, safe to call under any other lock
+    std::shared_ptr<TokenBucket> getCurrentTaskShaper() const {
+        std::lock_guard<std::mutex> lock(_shaperMutex);
+        return _currentTaskShaper;
+    }
+
     void requestTaskStop() {
         lfDebug() << "requestTaskStop";
         Common::PacketHeader packet;
@@ -109,13 +251,71 @@ public:
         handleUserPacket(packet, nullptr);
     }
 private:
+    //Pins host for the duration of one call, see onLinkDisconnect
+    class HostRef {
+    public:
+        HostRef(const NodeContext& node) : _node(node) {
+            ++_node._hostUsers;
+            _hostPtr = _node._host.load();
+        }
+        ~HostRef() {
+            --_node._hostUsers;
+        }
+        HostRef(const HostRef&) = delete;
+        HostRef& operator=(const HostRef&) = delete;
+        Host* operator->() const {
+            return _hostPtr;
+        }
+        bool operator==(std::nullptr_t) const {
+            return _hostPtr == nullptr;
+        }
+        bool operator!=(std::nullptr_t) const {
+            return _hostPtr != nullptr;
+        }
+    private:
+        const NodeContext& _node;
+        Host* _hostPtr;
+    };
+
+    LFramework::ComPtr<Common::IDataReceiver> createTaskContext(LFramework::ComPtr<Common::IDataReceiver> userDataReceiver, TaskContext** context = nullptr);
+
+    //Must be called with task lock held
+    void setCurrentTaskId(LFramework::Guid taskId) {
+        std::lock_guard<std::mutex> lock(_shaperMutex);
+        _currentTaskId = taskId;
+        _currentTaskShaper = findShaper(taskId);
+    }
+
+    //Must be called with shaper lock held
+    std::shared_ptr<TokenBucket> findShaper(LFramework::Guid taskId) const {
+        for(auto& shaper : _txShapers){
+            if(shaper.first == taskId){
+                return shaper.second;
+            }
+        }
+        return nullptr;
+    }
+
+    //Must be called with task lock held
+    void notifyStateChanged() {
+        if(_stateListener != nullptr){
+            _stateListener->nodeStateChanged(this, _tasks, isIdle());
+        }
+    }
+
     std::uint8_t _realId;
     std::uint32_t _tasksCount;
     std::vector<LFramework::Guid> _tasks;
-    Host* _host = nullptr;
+    std::atomic<Host*> _host = nullptr;
+    mutable std::atomic<std::uint32_t> _hostUsers = 0;
     mutable std::recursive_mutex _taskMutex;
     std::shared_ptr<TaskContextConstructor> _nextTask = nullptr;
     LFramework::ComPtr<ITaskContext> _currentTask = nullptr;
+    LFramework::Guid _currentTaskId = {};
+    mutable std::mutex _shaperMutex;
+    std::vector<std::pair<LFramework::Guid, std::shared_ptr<TokenBucket>>> _txShapers;
+    std::shared_ptr<TokenBucket> _currentTaskShaper;
+    INodeStateListener* _stateListener = nullptr;
 };
 
 }
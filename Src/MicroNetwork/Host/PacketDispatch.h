@@ -0,0 +1,202 @@
+#pragma once
+
+#include <MicroNetwork/Common/Packet.h>
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace MicroNetwork::Host {
+
+//Typed read-only view of packet payload. Points into packet buffer when payload is aligned for T,
+//otherwise holds an aligned copy, so field access is always safe
+template<typename T>
+class PacketView {
+    static_assert(std::is_trivially_copyable_v<T>, "Packet payload must be trivially copyable");
+public:
+    //std::nullopt if payload size does not match T
+    static std::optional<PacketView> parse(Common::PacketHeader header, const void* data) {
+        if((data == nullptr) || (header.size != sizeof(T))){
+            return std::nullopt;
+        }
+        return PacketView(data);
+    }
+
+    const T* get() const {
+        return _copied ? reinterpret_cast<const T*>(_storage) : static_cast<const T*>(_data);
+    }
+    const T& operator*() const {
+        return *get();
+    }
+    const T* operator->() const {
+        return get();
+    }
+    bool isZeroCopy() const {
+        return !_copied;
+    }
+private:
+    explicit PacketView(const void* data) : _data(data) {
+        if(reinterpret_cast<std::uintptr_t>(data) % alignof(T) != 0){
+            memcpy(_storage, data, sizeof(T));
+            _copied = true;
+        }
+    }
+
+    const void* _data;
+    bool _copied = false;
+    alignas(T) unsigned char _storage[sizeof(T)];
+};
+
+template<std::uint32_t Id, typename T>
+struct PacketBinding {
+    static constexpr std::uint32_t id = Id;
+    using Type = T;
+};
+
+//Outgoing packet built in place: header followed by payload, no serialization step
+template<typename TBinding>
+class OutgoingPacket {
+public:
+    using Type = typename TBinding::Type;
+    static_assert(std::is_trivially_copyable_v<Type>, "Packet payload must be trivially copyable");
+
+    OutgoingPacket() {
+        _header.id = TBinding::id;
+        _header.size = sizeof(Type);
+    }
+    Type& payload() {
+        return _payload;
+    }
+    Type* operator->() {
+        return &_payload;
+    }
+    Common::PacketHeader header() const {
+        return _header;
+    }
+    const void* data() const {
+        return &_payload;
+    }
+    //Sender is ComPtr<IDataReceiver>, for TaskSession use send(header(), data())
+    template<typename TSender>
+    auto sendTo(TSender& sender) const {
+        return sender->packet(_header, &_payload);
+    }
+private:
+    Common::PacketHeader _header;
+    Type _payload = {};
+};
+
+//Maps packet ids to typed handlers through a table built at compile time.
+//Handler is called as handler(binding, view) if such overload exists, otherwise handler(view)
+template<typename... TBindings>
+class PacketDispatchTable {
+public:
+    static constexpr std::size_t Count = sizeof...(TBindings);
+    static_assert(Count != 0, "Dispatch table is empty");
+
+    template<typename THandler>
+    static bool dispatch(THandler& handler, Common::PacketHeader header, const void* data) {
+        constexpr std::array<Entry<THandler>, Count> entries = { &invoke<THandler, TBindings>... };
+        auto index = findIndex(header.id);
+        if(index == Count){
+            return false;
+        }
+        return entries[index](handler, header, data);
+    }
+
+    static constexpr bool contains(std::uint32_t id) {
+        return findIndex(id) != Count;
+    }
+private:
+    template<typename THandler>
+    using Entry = bool(*)(THandler&, Common::PacketHeader, const void*);
+
+    static constexpr std::array<std::uint32_t, Count> Ids = { TBindings::id... };
+    static constexpr std::uint32_t MaxId = std::max({ TBindings::id... });
+    //Small id ranges use direct lookup, others binary search over sorted ids
+    static constexpr bool Dense = MaxId < 256;
+
+    static constexpr bool idsUnique() {
+        for(std::size_t i = 0; i < Count; ++i){
+            for(std::size_t j = i + 1; j < Count; ++j){
+                if(Ids[i] == Ids[j]){
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+    static_assert(idsUnique(), "Packet ids in dispatch table must be unique");
+
+    static constexpr auto makeDenseLookup() {
+        std::array<std::uint16_t, (Dense ? MaxId + 1 : 1)> result = {};
+        if constexpr (Dense){
+            for(std::size_t i = 0; i < Count; ++i){
+                result[Ids[i]] = static_cast<std::uint16_t>(i + 1);
+            }
+        }
+        return result;
+    }
+
+    static constexpr auto makeSortedLookup() {
+        std::array<std::pair<std::uint32_t, std::size_t>, Count> result = {};
+        for(std::size_t i = 0; i < Count; ++i){
+            result[i] = { Ids[i], i };
+        }
+        for(std::size_t i = 1; i < Count; ++i){
+            for(std::size_t j = i; (j > 0) && (result[j - 1].first > result[j].first); --j){
+                auto tmp = result[j - 1];
+                result[j - 1] = result[j];
+                result[j] = tmp;
+            }
+        }
+        return result;
+    }
+
+    static constexpr auto DenseLookup = makeDenseLookup();
+    static constexpr auto SortedLookup = makeSortedLookup();
+
+    static constexpr std::size_t findIndex(std::uint32_t id) {
+        if constexpr (Dense){
+            if((id > MaxId) || (DenseLookup[id] == 0)){
+                return Count;
+            }
+            return DenseLookup[id] - 1;
+        }else{
+            std::size_t low = 0;
+            std::size_t high = Count;
+            while(low < high){
+                auto middle = (low + high) / 2;
+                if(SortedLookup[middle].first < id){
+                    low = middle + 1;
+                }else{
+                    high = middle;
+                }
+            }
+            if((low == Count) || (SortedLookup[low].first != id)){
+                return Count;
+            }
+            return SortedLookup[low].second;
+        }
+    }
+
+    template<typename THandler, typename TBinding>
+    static bool invoke(THandler& handler, Common::PacketHeader header, const void* data) {
+        using View = PacketView<typename TBinding::Type>;
+        auto view = View::parse(header, data);
+        if(!view.has_value()){
+            return false;
+        }
+        if constexpr (std::is_invocable_v<THandler&, TBinding, const View&>){
+            handler(TBinding{}, *view);
+        }else{
+            handler(*view);
+        }
+        return true;
+    }
+};
+
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <chrono>
+
+namespace MicroNetwork::Host {
+
+using RxClock = std::chrono::steady_clock;
+
+//Implemented by link streams that know when bytes came off the bus
+class IRxTimestampSource {
+public:
+    virtual ~IRxTimestampSource() = default;
+    //Completion time of the transfer that delivered the most recent bytes
+    virtual RxClock::time_point getLastRxTimestamp() const = 0;
+};
+
+}
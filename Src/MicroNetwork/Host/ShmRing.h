@@ -0,0 +1,219 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <stdexcept>
+#include <algorithm>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <semaphore.h>
+#include <cerrno>
+#include <new>
+
+namespace MicroNetwork::Host {
+
+//Single producer single consumer byte ring in POSIX shared memory.
+//Data never passes through the kernel, semaphores are posted only when other side sleeps
+class ShmRing {
+public:
+    static std::shared_ptr<ShmRing> create(const std::string& name, std::size_t capacity) {
+        auto fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if(fd < 0){
+            throw std::runtime_error("Failed to create shared memory ring: " + name);
+        }
+        auto mappingSize = sizeof(Header) + capacity;
+        if(ftruncate(fd, static_cast<off_t>(mappingSize)) != 0){
+            ::close(fd);
+            shm_unlink(name.c_str());
+            throw std::runtime_error("Failed to resize shared memory ring: " + name);
+        }
+        auto result = std::shared_ptr<ShmRing>(new ShmRing(name, fd, mappingSize, true));
+        auto header = new (result->_header) Header();
+        header->capacity = capacity;
+        sem_init(&header->dataAvailable, 1, 0);
+        sem_init(&header->spaceAvailable, 1, 0);
+        return result;
+    }
+
+    static std::shared_ptr<ShmRing> open(const std::string& name) {
+        auto fd = shm_open(name.c_str(), O_RDWR, 0600);
+        if(fd < 0){
+            throw std::runtime_error("Failed to open shared memory ring: " + name);
+        }
+        struct stat fileStat;
+        if(fstat(fd, &fileStat) != 0 || static_cast<std::size_t>(fileStat.st_size) <= sizeof(Header)){
+            ::close(fd);
+            throw std::runtime_error("Invalid shared memory ring: " + name);
+        }
+        return std::shared_ptr<ShmRing>(new ShmRing(name, fd, static_cast<std::size_t>(fileStat.st_size), false));
+    }
+
+    ~ShmRing() {
+        if(_owner){
+            sem_destroy(&_header->dataAvailable);
+            sem_destroy(&_header->spaceAvailable);
+            shm_unlink(_name.c_str());
+        }
+        munmap(_header, _mappingSize);
+    }
+
+    const std::string& getName() const {
+        return _name;
+    }
+
+    std::size_t getCapacity() const {
+        return _header->capacity;
+    }
+
+    //Non-blocking, returns bytes written
+    std::size_t write(const void* data, std::size_t size) {
+        auto head = _header->head.load(std::memory_order_relaxed);
+        auto tail = _header->tail.load(std::memory_order_acquire);
+        auto capacity = _header->capacity;
+        size = std::min<std::size_t>(size, capacity - static_cast<std::size_t>(head - tail));
+        if(size == 0){
+            return 0;
+        }
+        auto offset = static_cast<std::size_t>(head % capacity);
+        auto firstPart = std::min(size, capacity - offset);
+        memcpy(_data + offset, data, firstPart);
+        memcpy(_data, static_cast<const std::uint8_t*>(data) + firstPart, size - firstPart);
+        _header->head.store(head + size);
+        if(_header->readerWaiting.exchange(0) != 0){
+            sem_post(&_header->dataAvailable);
+        }
+        return size;
+    }
+
+    //Non-blocking, returns bytes read
+    std::size_t read(void* data, std::size_t size) {
+        auto tail = _header->tail.load(std::memory_order_relaxed);
+        auto head = _header->head.load(std::memory_order_acquire);
+        auto capacity = _header->capacity;
+        size = std::min<std::size_t>(size, static_cast<std::size_t>(head - tail));
+        if(size == 0){
+            return 0;
+        }
+        auto offset = static_cast<std::size_t>(tail % capacity);
+        auto firstPart = std::min(size, capacity - offset);
+        memcpy(data, _data + offset, firstPart);
+        memcpy(static_cast<std::uint8_t*>(data) + firstPart, _data, size - firstPart);
+        _header->tail.store(tail + size);
+        if(_header->writerWaiting.exchange(0) != 0){
+            sem_post(&_header->spaceAvailable);
+        }
+        return size;
+    }
+
+    std::size_t bytesAvailable() const {
+        return static_cast<std::size_t>(_header->head.load() - _header->tail.load());
+    }
+
+    //Exact for producer side, consumer can only increase it
+    std::size_t freeSpace() const {
+        return _header->capacity - bytesAvailable();
+    }
+
+    //Blocking, returns false if ring was closed
+    bool writeAll(const void* data, std::size_t size) {
+        auto bytes = static_cast<const std::uint8_t*>(data);
+        while(size != 0){
+            if(isClosed()){
+                return false;
+            }
+            auto written = write(bytes, size);
+            bytes += written;
+            size -= written;
+            if(size != 0 && written == 0){
+                waitSpace();
+            }
+        }
+        return true;
+    }
+
+    //Blocking, returns false if ring was closed
+    bool readAll(void* data, std::size_t size) {
+        auto bytes = static_cast<std::uint8_t*>(data);
+        while(size != 0){
+            auto done = read(bytes, size);
+            bytes += done;
+            size -= done;
+            if(size != 0 && done == 0){
+                if(isClosed()){
+                    return false;
+                }
+                waitData();
+            }
+        }
+        return true;
+    }
+
+    void waitData() {
+        _header->readerWaiting.store(1);
+        if(bytesAvailable() == 0 && !isClosed()){
+            semWait(&_header->dataAvailable);
+        }
+        _header->readerWaiting.store(0);
+    }
+
+    void waitSpace() {
+        _header->writerWaiting.store(1);
+        if(bytesAvailable() == _header->capacity && !isClosed()){
+            semWait(&_header->spaceAvailable);
+        }
+        _header->writerWaiting.store(0);
+    }
+
+    void close() {
+        _header->closed.store(1);
+        sem_post(&_header->dataAvailable);
+        sem_post(&_header->spaceAvailable);
+    }
+
+    bool isClosed() const {
+        return _header->closed.load() != 0;
+    }
+private:
+    struct Header {
+        std::atomic<std::uint64_t> head = 0;
+        std::atomic<std::uint64_t> tail = 0;
+        std::atomic<std::uint32_t> readerWaiting = 0;
+        std::atomic<std::uint32_t> writerWaiting = 0;
+        std::atomic<std::uint32_t> closed = 0;
+        std::size_t capacity = 0;
+        sem_t dataAvailable;
+        sem_t spaceAvailable;
+    };
+
+    ShmRing(std::string name, int fd, std::size_t mappingSize, bool owner) : _name(name), _mappingSize(mappingSize), _owner(owner) {
+        auto mapping = mmap(nullptr, mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if(mapping == MAP_FAILED){
+            if(owner){
+                shm_unlink(name.c_str());
+            }
+            throw std::runtime_error("Failed to map shared memory ring: " + name);
+        }
+        _header = static_cast<Header*>(mapping);
+        _data = static_cast<std::uint8_t*>(mapping) + sizeof(Header);
+    }
+
+    static void semWait(sem_t* semaphore) {
+        while(sem_wait(semaphore) != 0 && errno == EINTR){
+
+        }
+    }
+
+    std::string _name;
+    std::size_t _mappingSize;
+    bool _owner;
+    Header* _header = nullptr;
+    std::uint8_t* _data = nullptr;
+};
+
+}
@@ -4,29 +4,75 @@
 namespace MicroNetwork::Host {
 
 LFramework::Result TaskContext::packet(Common::PacketHeader header, const void* data) {
+    std::shared_ptr<TokenBucket> shaper;
+    {
+        std::lock_guard<std::recursive_mutex> lock(_taskMutex);
+        if(_txClosed || (_userDataReceiver == nullptr)){
+            return LFramework::Result::UnknownFailure;
+        }
+        if(header.id != Common::PacketId::TaskStop){
+            shaper = _node->getCurrentTaskShaper();
+        }
+    }
+    //Throttle wait holds no task lock, so link RX thread keeps delivering packets meanwhile
+    auto packetSize = static_cast<std::uint32_t>(sizeof(header) + header.size);
+    if(shaper != nullptr){
+        shaper->consumeBlocking(packetSize);
+    }
+
     std::lock_guard<std::recursive_mutex> lock(_taskMutex);
     if(!_txClosed && _userDataReceiver != nullptr){
         return _node->handleUserPacket(header, data) ? LFramework::Result::Ok : LFramework::Result::UnknownFailure;
     }else{
+        if(shaper != nullptr){
+            shaper->refund(packetSize);
+        }
         return LFramework::Result::UnknownFailure;
     }
 }
 
 
+TxStatus TaskContext::tryPacket(Common::PacketHeader header, const void* data) {
+    std::lock_guard<std::recursive_mutex> lock(_txMutex);
+    if(_txClosed || (_node == nullptr)){
+        return TxStatus::Closed;
+    }
+    return _node->tryHandleUserPacket(header, data);
+}
+
+TxStatus TaskContext::tryStop() {
+    std::lock_guard<std::recursive_mutex> lock(_txMutex);
+    if(_txClosed || (_node == nullptr)){
+        return TxStatus::Closed;
+    }
+    Common::PacketHeader header;
+    header.id = Common::PacketId::TaskStop;
+    header.size = 0;
+    auto status = _node->tryHandleUserPacket(header, nullptr);
+    if(status != TxStatus::WouldBlock){
+        _txClosed = true;
+    }
+    return status;
+}
+
 void TaskContext::onNetworkRelease() {
     std::lock_guard<std::recursive_mutex> lock(_taskMutex);
-    _txClosed = true;
-    _node = nullptr;
+    {
+        std::lock_guard<std::recursive_mutex> txLock(_txMutex);
+        _txClosed = true;
+        _node = nullptr;
+    }
     _userDataReceiver.reset();
+    _timestampedReceiver.reset();
 
 
 }
 void TaskContext::onUserRelease() {
     std::lock_guard<std::recursive_mutex> lock(_taskMutex);
-    if(_node != nullptr){
+    if((_node != nullptr) && !_txClosed){
         _node->requestTaskStop();
     }
-   
+    std::lock_guard<std::recursive_mutex> txLock(_txMutex);
     _txClosed = true;
 }
 
@@ -2,28 +2,40 @@
 
 #include <MicroNetwork.Common.h>
 #include <MicroNetwork/Host/ITaskContext.h>
+#include <MicroNetwork/Host/ITimestampedDataReceiver.h>
 #include <atomic>
 #include <mutex>
 
 namespace MicroNetwork::Host {
 
 class NodeContext;
+enum class TxStatus;
+
 class TaskContext : public LFramework::RefCountedObject {
 public:
     TaskContext(NodeContext* node) : _node(node) {
 
     }
-    LFramework::Result handleNetworkPacket(Common::PacketHeader header, const void* data) {
+    LFramework::Result handleNetworkPacket(Common::PacketHeader header, const void* data, std::int64_t rxTimestamp) {
         std::lock_guard<std::recursive_mutex> lock(_taskMutex);
-        if(_userDataReceiver != nullptr){
+        if(_timestampedReceiver != nullptr){
+            _timestampedReceiver->timestampedPacket(header, data, rxTimestamp);
+        }else if(_userDataReceiver != nullptr){
             _userDataReceiver->packet(header, data);
         }
         return LFramework::Result::Ok;
     }
     LFramework::Result packet(Common::PacketHeader header, const void* data);
+    //Non-blocking packet(): reports full link or rate limit instead of waiting. Takes only TX lock,
+    //so it does not wait behind link RX thread delivering to user receiver
+    TxStatus tryPacket(Common::PacketHeader header, const void* data);
+    //Non-blocking stop request. Once TaskStop is written the task is closed for TX and
+    //releasing the user handle does not send it again
+    TxStatus tryStop();
 
     LFramework::Result setUserDataReceiver(LFramework::ComPtr<Common::IDataReceiver> userDataReceiver) {
         _userDataReceiver = userDataReceiver;
+        _timestampedReceiver = (userDataReceiver != nullptr) ? userDataReceiver.queryInterface<ITimestampedDataReceiver>() : nullptr;
         return LFramework::Result::Ok;
     }
 
@@ -31,9 +43,11 @@ public:
     void onUserRelease();
 private:
     std::recursive_mutex _taskMutex;
+    //_txClosed and _node are written under both locks and read under either
     std::recursive_mutex _txMutex;
     bool _txClosed = false;
     LFramework::ComPtr<Common::IDataReceiver> _userDataReceiver;
+    LFramework::ComPtr<ITimestampedDataReceiver> _timestampedReceiver;
     NodeContext* _node;
 };
 
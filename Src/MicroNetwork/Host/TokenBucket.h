@@ -0,0 +1,101 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <algorithm>
+
+namespace MicroNetwork::Host {
+
+struct RateLimit {
+    std::uint32_t bytesPerSecond;
+    std::uint32_t burstBytes;
+};
+
+struct TokenBucketStats {
+    double tokens;
+    std::uint64_t throttleCount;
+    std::uint64_t passedBytes;
+};
+
+class TokenBucket {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    TokenBucket(RateLimit limit) : _limit(limit), _tokens(limit.burstBytes), _lastRefill(Clock::now()) {
+
+    }
+
+    void setLimit(RateLimit limit) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        refill();
+        _limit = limit;
+        _tokens = std::min(_tokens, static_cast<double>(_limit.burstBytes));
+    }
+
+    //Full size is always charged. Packet bigger than burst passes once bucket is full
+    //and leaves a deficit that following packets wait out, so long-term rate holds for any packet size
+    bool tryConsume(std::uint32_t bytes) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        refill();
+        if(_tokens < getThreshold(bytes)){
+            ++_throttleCount;
+            return false;
+        }
+        _tokens -= bytes;
+        _passedBytes += bytes;
+        return true;
+    }
+
+    //Return tokens of a packet that was not sent after all
+    void refund(std::uint32_t bytes) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _tokens = std::min(static_cast<double>(_limit.burstBytes), _tokens + bytes);
+        _passedBytes -= bytes;
+    }
+
+    //Time until 'bytes' can be consumed
+    std::chrono::microseconds getDelay(std::uint32_t bytes) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        refill();
+        auto threshold = getThreshold(bytes);
+        if((_tokens >= threshold) || (_limit.bytesPerSecond == 0)){
+            return std::chrono::microseconds(0);
+        }
+        return std::chrono::microseconds(static_cast<std::int64_t>((threshold - _tokens) * 1e6 / _limit.bytesPerSecond) + 1);
+    }
+
+    void consumeBlocking(std::uint32_t bytes) {
+        while(!tryConsume(bytes)){
+            std::this_thread::sleep_for(getDelay(bytes));
+        }
+    }
+
+    TokenBucketStats getStats() {
+        std::lock_guard<std::mutex> lock(_mutex);
+        refill();
+        return TokenBucketStats{ _tokens, _throttleCount, _passedBytes };
+    }
+private:
+    //Tokens required before 'bytes' may pass
+    double getThreshold(std::uint32_t bytes) const {
+        return static_cast<double>(std::min(bytes, _limit.burstBytes));
+    }
+
+    void refill() {
+        auto now = Clock::now();
+        std::chrono::duration<double> elapsed = now - _lastRefill;
+        _lastRefill = now;
+        _tokens = std::min(static_cast<double>(_limit.burstBytes), _tokens + elapsed.count() * _limit.bytesPerSecond);
+    }
+
+    std::mutex _mutex;
+    RateLimit _limit;
+    double _tokens;
+    Clock::time_point _lastRefill;
+    std::uint64_t _throttleCount = 0;
+    std::uint64_t _passedBytes = 0;
+};
+
+}
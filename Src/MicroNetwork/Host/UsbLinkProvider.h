@@ -10,8 +10,8 @@ namespace MicroNetwork::Host {
 
 class UsbLinkProvider : public LinkProvider {
 public:
-    UsbLinkProvider(std::optional<std::uint16_t> vid, std::optional<std::uint16_t> pid, ILinkCallback* linkCallback) : LinkProvider(linkCallback),
-     _vid(vid), _pid(pid){
+    UsbLinkProvider(std::optional<std::uint16_t> vid, std::optional<std::uint16_t> pid, ILinkCallback* linkCallback, LinkConfigResolver linkConfigResolver = {}) : LinkProvider(linkCallback),
+     _vid(vid), _pid(pid), _linkConfigResolver(linkConfigResolver){
         _usbService = std::shared_ptr<LFramework::USB::IUsbService>(LFramework::USB::createUsbService());
         _usbService->startEventsListening(std::bind(&UsbLinkProvider::onUsbDevicesChange, this));
     }
@@ -22,6 +22,7 @@ public:
 private:
     std::optional<std::uint16_t> _vid;
     std::optional<std::uint16_t> _pid;
+    LinkConfigResolver _linkConfigResolver;
 
     void onUsbDevicesChange() {
         onLinksUpdated();
@@ -42,7 +43,7 @@ private:
 
     std::shared_ptr<Common::DataStream> makeStream(const std::string& linkPath) override {
         std::shared_ptr<LFramework::USB::IUsbDevice> device(LFramework::USB::openUsbDevice(linkPath));
-        return std::make_shared<Host::UsbTransmitter>(device);
+        return std::make_shared<Host::UsbTransmitter>(device, _linkConfigResolver ? _linkConfigResolver(linkPath) : LinkConfig{});
     }
 
     std::shared_ptr<LFramework::USB::IUsbService> _usbService;
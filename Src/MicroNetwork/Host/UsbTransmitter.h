@@ -7,25 +7,38 @@
 #include <LFramework/Threading/Semaphore.h>
 #include <LFramework/Threading/CriticalSection.h>
 #include <thread>
+#include <mutex>
+#include <atomic>
 #include <functional>
+#include <deque>
 #include <LFramework/Debug.h>
+#include <MicroNetwork/Host/RxTimestamp.h>
+#include <MicroNetwork/Host/LinkProvider.h>
+#include <MicroNetwork/Host/LinkRingBuffer.h>
 
 namespace MicroNetwork::Host {
 
-class UsbTransmitter : public Common::DataStream {
+class UsbTransmitter : public Common::DataStream, public IRxTimestampSource, public ILinkStatsSource {
 public:
-    UsbTransmitter(std::shared_ptr<LFramework::USB::IUsbDevice> device) : _device(device) {
+    UsbTransmitter(std::shared_ptr<LFramework::USB::IUsbDevice> device, LinkConfig config = {}) : _device(device) {
         auto usbInterface = _device->getInterface(0);
         _txEndpoint = usbInterface->getEndpoint(false, 0);
         _rxEndpoint = usbInterface->getEndpoint(true, 0);
+        if(config.rxRingSize != 0){
+            _rxRing = std::make_unique<LinkRingBuffer>(config.rxRingSize, config.hugePages);
+        }
     }
 
     ~UsbTransmitter() {
-        _running = false;
+        cancel();
         if(_rxThread.joinable()){
             _rxJob.give();
             _rxThread.join();
         }
+        if(_rxDeliveryThread.joinable()){
+            _rxRingData.give();
+            _rxDeliveryThread.join();
+        }
         if(_txThread.joinable()){
              _txJob.give();
             _txThread.join();
@@ -46,6 +59,9 @@ public:
 
         _rxThread = std::thread(std::bind(&UsbTransmitter::rxThreadHandler, this));
         _txThread = std::thread(std::bind(&UsbTransmitter::txThreadHandler, this));
+        if(_rxRing != nullptr){
+            _rxDeliveryThread = std::thread(std::bind(&UsbTransmitter::rxDeliveryThreadHandler, this));
+        }
 
         lfDebug() << "USB transmitter started";
         return true;
@@ -54,6 +70,41 @@ public:
     bool running() const {
         return _running;
     }
+
+    RxClock::time_point getLastRxTimestamp() const override {
+        return RxClock::time_point(RxClock::duration(_lastRxTimestamp.load()));
+    }
+
+    LinkStats getLinkStats() const override {
+        LinkStats result;
+        if(_rxRing != nullptr){
+            result.rxRingCapacity = _rxRing->getCapacity();
+            result.rxRingHighWaterMark = _rxRing->getHighWaterMark();
+            result.rxRingHugePages = _rxRing->isHugePageBacked();
+        }
+        result.rxStalls = _rxStalls;
+        return result;
+    }
+
+    //Aborts in-flight RX chain and TX transfer, threads exit without waiting for transfer timeout
+    void cancel() {
+        _running = false;
+        {
+            std::lock_guard<std::mutex> lock(_transferMutex);
+            for(auto& item : _readChain){
+                if(item->asyncResult != nullptr){
+                    item->asyncResult->cancel();
+                }
+            }
+            if(_txTransfer != nullptr){
+                _txTransfer->cancel();
+            }
+        }
+        _rxJob.give();
+        _txJob.give();
+        _rxRingData.give();
+        _rxRingSpace.give();
+    }
 private:
     struct ReadChainItem {
        explicit ReadChainItem(size_t bufferSize) {
@@ -68,7 +119,7 @@ private:
     };
 
     void onRemoteDisconnect() override {
-
+        cancel();
     }
     void onRemoteReset() override {
 
@@ -81,7 +132,19 @@ private:
     }
 
     size_t usbTransmit(void* data, uint32_t size) {
-        auto result = _txEndpoint->transferAsync(data, size)->wait();
+        std::shared_ptr<LFramework::USB::IUsbTransfer> transfer;
+        {
+            std::lock_guard<std::mutex> lock(_transferMutex);
+            if(!_running){
+                throw std::runtime_error("USB transmitter cancelled");
+            }
+            transfer = _txEndpoint->transferAsync(data, size);
+            _txTransfer = transfer;
+        }
+        auto result = transfer->wait();
+
+        std::lock_guard<std::mutex> lock(_transferMutex);
+        _txTransfer = nullptr;
         return result;
     }
 
@@ -94,6 +157,13 @@ private:
             try {
                 for(auto& item : _readChain){
                     auto rxSize = item->asyncResult->wait();
+                    auto rxTimestamp = RxClock::now().time_since_epoch().count();
+                    if(_rxRing == nullptr){
+                        _lastRxTimestamp = rxTimestamp;
+                    }
+                    if(!_running){
+                        break;
+                    }
 
                     //lfDebug() << "Received USB packet: size=" << rxSize;
                     if(rxSize == 0){
@@ -101,14 +171,19 @@ private:
                         //lfDebug() << "Sync received";
                     }else {
                         if(_synchronized) {
-                            std::size_t doneRxSize = 0;
-                            while(true){
-                                doneRxSize += write(item->buffer.data() + doneRxSize, rxSize - doneRxSize);
-                                if(_running && (doneRxSize != rxSize)){
-                                    lfDebug() << "RX buffer stall";
-                                    _rxJob.take();
-                                }else{
-                                    break;
+                            if(_rxRing != nullptr){
+                                stageRx(item->buffer.data(), rxSize, rxTimestamp);
+                            }else{
+                                std::size_t doneRxSize = 0;
+                                while(true){
+                                    doneRxSize += write(item->buffer.data() + doneRxSize, rxSize - doneRxSize);
+                                    if(_running && (doneRxSize != rxSize)){
+                                        lfDebug() << "RX buffer stall";
+                                        ++_rxStalls;
+                                        _rxJob.take();
+                                    }else{
+                                        break;
+                                    }
                                 }
                             }
                         }else{
@@ -116,9 +191,11 @@ private:
                         }
                     }
 
-                    if(_running){
-                        item->readAsync(_rxEndpoint);
+                    std::lock_guard<std::mutex> lock(_transferMutex);
+                    if(!_running){
+                        break;
                     }
+                    item->readAsync(_rxEndpoint);
                 }
 
             }catch (std::exception& ex){
@@ -130,6 +207,61 @@ private:
         notifyDisconnect();
     }
 
+    //Copies completed transfer to RX ring so read can be reposted without waiting for packet parsing
+    void stageRx(const std::uint8_t* data, std::size_t size, RxClock::rep timestamp) {
+        //Chunk is recorded before its bytes, delivery always finds timestamp of bytes it reads
+        _rxStagedBytes += size;
+        {
+            std::lock_guard<std::mutex> lock(_rxChunksMutex);
+            _rxChunks.push_back(RxChunk{ _rxStagedBytes, timestamp });
+        }
+        std::size_t doneSize = 0;
+        while(true){
+            doneSize += _rxRing->write(data + doneSize, size - doneSize);
+            _rxRingData.give();
+            if(_running && (doneSize != size)){
+                lfDebug() << "RX ring stall";
+                ++_rxStalls;
+                _rxRingSpace.take();
+            }else{
+                break;
+            }
+        }
+    }
+
+    //Moves RX ring contents to the stream as the Host consumes it. Each write stays within one
+    //transfer and publishes that transfer's completion time, so packets are stamped with the
+    //transfer that completed them rather than the latest one
+    void rxDeliveryThreadHandler() {
+        std::uint64_t deliveredBytes = 0;
+        while(_running){
+            std::size_t size = 0;
+            auto data = _rxRing->readRegion(size);
+            if(size == 0){
+                _rxRingData.take();
+                continue;
+            }
+            RxChunk chunk;
+            {
+                std::lock_guard<std::mutex> lock(_rxChunksMutex);
+                while(_rxChunks.front().end <= deliveredBytes){
+                    _rxChunks.pop_front();
+                }
+                chunk = _rxChunks.front();
+            }
+            size = std::min<std::size_t>(size, static_cast<std::size_t>(chunk.end - deliveredBytes));
+            _lastRxTimestamp = chunk.timestamp;
+            auto written = write(data, size);
+            if(written != 0){
+                deliveredBytes += written;
+                _rxRing->consume(written);
+                _rxRingSpace.give();
+            }else{
+                _rxJob.take();
+            }
+        }
+    }
+
     void txThreadHandler() {
         std::vector<uint8_t> txBuffer;
         txBuffer.resize(_txEndpoint->getDescriptor().wMaxPacketSize);
@@ -164,9 +296,24 @@ private:
 
     bool _synchronized = false;
 
-    bool _running = false;
+    std::atomic<bool> _running = false;
+    std::atomic<RxClock::rep> _lastRxTimestamp = 0;
     std::thread _rxThread;
     std::thread _txThread;
+    std::thread _rxDeliveryThread;
+    struct RxChunk {
+        std::uint64_t end;
+        RxClock::rep timestamp;
+    };
+
+    std::unique_ptr<LinkRingBuffer> _rxRing;
+    //Stream offset after each staged transfer with its completion time, producer is RX thread
+    std::uint64_t _rxStagedBytes = 0;
+    std::mutex _rxChunksMutex;
+    std::deque<RxChunk> _rxChunks;
+    std::atomic<std::uint64_t> _rxStalls = 0;
+    LFramework::Threading::BinarySemaphore _rxRingData;
+    LFramework::Threading::BinarySemaphore _rxRingSpace;
 
     LFramework::Threading::BinarySemaphore _rxJob;
     LFramework::Threading::BinarySemaphore _txJob;
@@ -174,6 +321,8 @@ private:
     LFramework::USB::IUsbHostEndpoint* _rxEndpoint = nullptr;
     std::shared_ptr<LFramework::USB::IUsbDevice> _device;
     std::vector<std::shared_ptr<ReadChainItem>> _readChain;
+    std::mutex _transferMutex;
+    std::shared_ptr<LFramework::USB::IUsbTransfer> _txTransfer;
 };
 
 }